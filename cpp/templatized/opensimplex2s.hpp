@@ -1,9 +1,24 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <initializer_list>
+#include <limits>
+#include <ratio>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+
+#ifdef OSN_ENABLE_COUNTERS
+#include "opensimplex2s_counters.hpp"
+#else
+#define OSN_COUNT(...)
+#endif
 
 
 namespace osn
@@ -32,12 +47,74 @@ namespace _detail
 	template<size_t N, uint32_t _Dimensions, typename _Float, typename _Int>
 	struct pregen_lattice_list_initializer;
 
-	template<uint32_t _Dimensions, typename _Float, typename _Int>
+	// Default squared radius of the kernel, which the lattice tables are built to reach.
+	template<uint32_t _Dimensions>
+	struct kernel_radius;
+
+	template<>
+	struct kernel_radius<2>
+	{
+		typedef std::ratio<2, 3> type;
+	};
+
+	template<>
+	struct kernel_radius<3>
+	{
+		typedef std::ratio<3, 4> type;
+	};
+
+	template<>
+	struct kernel_radius<4>
+	{
+		typedef std::ratio<4, 5> type;
+	};
+
+	template<uint32_t _Dimensions, typename _RadiusSq>
+	struct kernel_traits;
+
+	template<uint32_t _Dimensions, typename _Float, typename _Int, typename _RadiusSq>
+	struct pruned_lattice;
+
+	template<
+	      uint32_t _Dimensions,
+	      typename _Float,
+	      typename _Int,
+	      typename _RadiusSq = typename kernel_radius<_Dimensions>::type>
 	struct noise_impl;
 
 	template<uint32_t _Dimensions, typename _ModeEnum, _ModeEnum mode>
 	struct noise_mode_impl;
 
+	template<uint32_t _Dimensions>
+	struct lattice_point_fixed;
+
+	template<uint32_t _Dimensions>
+	struct pregen_gradients_fixed;
+
+	template<uint32_t _Dimensions>
+	struct pregen_lattice_fixed;
+
+	template<uint32_t _Dimensions>
+	struct pregen_fixed_initializer;
+
+	template<uint32_t _Dimensions>
+	struct noise_fixed_impl;
+
+	template<typename _SeedT>
+	struct seed_shuffle;
+
+	template<uint32_t _Dimensions, typename _ModeImpl, typename _Float, typename _Int, typename _RadiusSq>
+	struct grid_impl;
+
+	template<uint32_t _Dimensions>
+	struct bounds_traits;
+
+	template<uint32_t _Dimensions, typename _ModeImpl, typename _Float, typename _RadiusSq>
+	struct bounds_impl;
+
+	template<typename _Out>
+	struct quantizer;
+
 } // namespace _detail
 
 enum class Mode
@@ -54,45 +131,299 @@ enum class Mode
 };
 
 
-template<uint32_t _Dimensions, Mode _Mode, typename _Float = float, typename _Int = int32_t>
+// IEEE half-precision value, stored as its bits. Converted from float with rounding to nearest even.
+struct Half
+{
+	uint16_t bits = 0;
+
+	Half() = default;
+
+	explicit Half(float f)
+	{
+		uint32_t x;
+		std::memcpy(&x, &f, sizeof(x));
+		uint32_t sign = (x >> 16) & 0x8000, a = x & 0x7FFFFFFF;
+		if (a >= 0x47800000)
+		{
+			// Beyond the half range: infinity, or a quiet NaN.
+			bits = uint16_t(sign | (a > 0x7F800000 ? 0x7E00 : 0x7C00));
+		}
+		else if (a < 0x38800000)
+		{
+			// Subnormal: adding 0.5 aligns the mantissa so that the float addition rounds it.
+			float r;
+			std::memcpy(&r, &a, sizeof(r));
+			r += 0.5f;
+			std::memcpy(&a, &r, sizeof(a));
+			bits = uint16_t(sign | (a - 0x3F000000));
+		}
+		else
+		{
+			// Rebias the exponent and round the 13 dropped mantissa bits, ties to even.
+			a += 0xC8000FFF + ((a >> 13) & 1);
+			bits = uint16_t(sign | (a >> 13));
+		}
+	}
+
+	explicit operator float() const
+	{
+		uint32_t sign = uint32_t(bits & 0x8000) << 16, exponent = (bits >> 10) & 0x1F, mantissa = bits & 0x3FF;
+		if (exponent == 0)
+		{
+			float f = float(mantissa) * (1.0f / 16777216.0f);
+			return sign ? -f : f;
+		}
+		uint32_t x = sign | (exponent == 31 ? 0x7F800000 | (mantissa << 13) : ((exponent + 112) << 23) | (mantissa << 13));
+		float f;
+		std::memcpy(&f, &x, sizeof(f));
+		return f;
+	}
+};
+
+// bfloat16 value, the upper half of a float, stored as its bits. Converted from float with rounding to nearest even.
+struct BFloat16
+{
+	uint16_t bits = 0;
+
+	BFloat16() = default;
+
+	explicit BFloat16(float f)
+	{
+		uint32_t x;
+		std::memcpy(&x, &f, sizeof(x));
+		bits = (x & 0x7FFFFFFF) > 0x7F800000 ? uint16_t((x >> 16) | 0x40) : uint16_t((x + 0x7FFF + ((x >> 16) & 1)) >> 16);
+	}
+
+	explicit operator float() const
+	{
+		uint32_t x = uint32_t(bits) << 16;
+		float f;
+		std::memcpy(&f, &x, sizeof(f));
+		return f;
+	}
+};
+
+// The seed's integer type selects its shuffle as much as its value does: seeds equal as uint64_t but of another width
+// or signedness give other noise. This tags the type, for keys and headers that identify noise by its seed.
+template<typename _SeedT>
+constexpr uint32_t seed_type_of()
+{
+	static_assert(std::is_integral<_SeedT>::value, "Seeds are integers");
+	return uint32_t(sizeof(_SeedT) * 2) | uint32_t(std::is_signed<_SeedT>::value);
+}
+
+
+// _RadiusSq, a std::ratio, is the squared radius of each lattice point's kernel. It defaults to the largest the lattice
+// tables reach (2/3, 3/4 and 4/5 in 2D, 3D and 4D); smaller radii give sparser, blobbier noise that evaluates fewer
+// lattice points, using tables pruned at compile time of the points no longer in reach.
+template<
+      uint32_t _Dimensions,
+      Mode _Mode,
+      typename _Float = float,
+      typename _Int = int32_t,
+      typename _RadiusSq = typename _detail::kernel_radius<_Dimensions>::type>
 class OpenSimplex2S
 {
+	static_assert(
+	      std::ratio_greater<_RadiusSq, std::ratio<0>>::value
+	            && std::ratio_less_equal<_RadiusSq, typename _detail::kernel_radius<_Dimensions>::type>::value,
+	      "The kernel radius must be positive and at most the default");
+
   private:
 	std::array<uint16_t, _detail::PSIZE> perm;
 	std::array<_detail::grad<_Dimensions, _Float>, _detail::PSIZE> permGrad;
+	uint64_t seedValue;
+	uint32_t seedType;
+
+	typedef _detail::noise_mode_impl<_Dimensions, Mode, _Mode> mode_impl_t;
+	typedef _detail::grid_impl<_Dimensions, mode_impl_t, _Float, _Int, _RadiusSq> grid_impl_t;
+	typedef _detail::bounds_impl<_Dimensions, mode_impl_t, _Float, _RadiusSq> bounds_impl_t;
+	typedef _detail::kernel_traits<_Dimensions, _RadiusSq> kernel_t;
 
   public:
+	static constexpr uint32_t Dimensions = _Dimensions;
+	static constexpr Mode NoiseMode = _Mode;
+	typedef _Float float_type;
+	typedef _Int int_type;
+	typedef _RadiusSq radius_sq_type;
+
 	template<typename _SeedT = uint64_t>
 	constexpr OpenSimplex2S(_SeedT seed = 0)
 	{
-		std::array<short, _detail::PSIZE> source;
-		for (short i = 0; i < _detail::PSIZE; i++)
-		{
-			source[i] = i;
-		}
-		for (int32_t i = _detail::PSIZE - 1; i >= 0; i -= 1)
-		{
-			seed = seed * 6364136223846793005L + 1442695040888963407L;
-			_SeedT r = (_SeedT)((seed + 31) % (i + 1));
+		reseed(seed);
+	}
 
-			perm[i] = source[r];
-			permGrad[i] = _detail::pregen_gradients<_Dimensions, _Float>::grads[perm[i]];
-			source[r] = source[i];
+	// Rebuilds the tables for seed in place; the noise is then the same as OpenSimplex2S(seed).
+	template<typename _SeedT>
+	constexpr void reseed(_SeedT seed)
+	{
+		seedValue = uint64_t(seed);
+		seedType = seed_type_of<_SeedT>();
+		_detail::seed_shuffle<_SeedT>::shuffle(perm, permGrad, seed);
+		if constexpr (kernel_t::Pruned)
+		{
+			for (_detail::grad<_Dimensions, _Float>& g : permGrad)
+			{
+				g *= _Float(kernel_t::GradientScale);
+			}
 		}
 	}
 
-
 	template<
 	      typename... _F,
 	      class = std::common_type<_Float, _F...>,
 	      std::enable_if_t<(sizeof...(_F) == _Dimensions)>* = nullptr>
-	_Float operator()(_F... vals)
+	_Float operator()(_F... vals) const
 	{
-		return _detail::noise_mode_impl<_Dimensions, Mode, _Mode>::template eval<_Float, _Int>(
+		return _detail::noise_mode_impl<_Dimensions, Mode, _Mode>::template eval<_Float, _Int, _RadiusSq>(
 		      permGrad,
 		      perm,
 		      _Float(vals)...);
 	}
+
+	// Vector-valued noise for directionally uniform domain warping: disc output in 2D, ball output in 3D. Each lattice
+	// point applies a random rotation to its offset through the same falloff, so one lattice traversal yields every
+	// component. Component 0 is operator(); the others are distributed like it and uncorrelated with it.
+	template<
+	      typename... _F,
+	      class = std::common_type<_Float, _F...>,
+	      std::enable_if_t<(sizeof...(_F) == _Dimensions && (_Dimensions == 2 || _Dimensions == 3))>* = nullptr>
+	std::array<_Float, _Dimensions> vector(_F... vals) const
+	{
+		typedef _detail::noise_impl<_Dimensions, _Float, _Int, _RadiusSq> noise_t;
+		return std::apply(
+		      [&](auto... v) { return noise_t::eval_vector(permGrad, perm, v...); },
+		      mode_impl_t::transform(_Float(vals)...));
+	}
+
+	uint64_t seed() const { return seedValue; }
+	// seed_type_of() the seed's type; seed() alone does not identify the noise.
+	uint32_t seed_type() const { return seedType; }
+
+	// Fills out with the noise sampled on a regular grid of the given size, starting at origin and spaced by step.
+	// x varies fastest; out must hold the product of the sizes.
+	void generate(
+	      _Float* out,
+	      const std::array<size_t, _Dimensions>& size,
+	      const std::array<_Float, _Dimensions>& origin,
+	      _Float step) const
+	{
+		grid_impl_t::generate(permGrad, perm, out, size, origin, step);
+	}
+
+	// Fills out with a width * height frame of the plane whose trailing coordinates are fixed at slice, such as time
+	// in an animated texture; x varies fastest. The fixed coordinates' share of the orientation transform is computed
+	// once per frame, leaving each pixel an offset along the frame's two axes.
+	template<uint32_t _D = _Dimensions, std::enable_if_t<(_D == 3 || _D == 4)>* = nullptr>
+	void generate_slice(
+	      _Float* out,
+	      size_t width,
+	      size_t height,
+	      const std::array<_Float, 2>& origin,
+	      _Float step,
+	      const std::array<_Float, _Dimensions - 2>& slice) const
+	{
+		std::array<size_t, _Dimensions> size;
+		std::array<_Float, _Dimensions> sliceOrigin;
+		size.fill(1);
+		size[0] = width;
+		size[1] = height;
+		sliceOrigin[0] = origin[0];
+		sliceOrigin[1] = origin[1];
+		std::copy(slice.begin(), slice.end(), sliceOrigin.begin() + 2);
+		grid_impl_t::generate(permGrad, perm, out, size, sliceOrigin, step);
+	}
+
+	// Returns a guaranteed [min, max] of the noise over the axis-aligned box [boxMin, boxMax].
+	// The bound tightens as the box shrinks, so a hierarchical mesher can skip boxes that cannot cross its isovalue.
+	std::pair<_Float, _Float> range(
+	      const std::array<_Float, _Dimensions>& boxMin,
+	      const std::array<_Float, _Dimensions>& boxMax) const
+	{
+		std::pair<double, double> r = bounds_impl_t::range(permGrad, perm, boxMin, boxMax);
+		return { _Float(r.first), _Float(r.second) };
+	}
+
+	// Returns a bound on the norm of the Hessian of the noise over the box [boxMin, boxMax].
+	_Float curvature(const std::array<_Float, _Dimensions>& boxMin, const std::array<_Float, _Dimensions>& boxMax) const
+	{
+		return _Float(bounds_impl_t::curvature(permGrad, perm, boxMin, boxMax));
+	}
+
+	// Fractal sum of octaves: sum over o < octaves of gain^o * noise(p * lacunarity^o).
+	template<
+	      typename... _F,
+	      class = std::common_type<_Float, _F...>,
+	      std::enable_if_t<(sizeof...(_F) == _Dimensions)>* = nullptr>
+	_Float fbm(uint32_t octaves, _Float lacunarity, _Float gain, _F... vals) const
+	{
+		_Float value = 0, amplitude = 1, frequency = 1;
+		for (uint32_t o = 0; o < octaves; ++o)
+		{
+			value += amplitude * (*this)((_Float(vals) * frequency)...);
+			amplitude *= gain;
+			frequency *= lacunarity;
+		}
+		return value;
+	}
+
+	// Returns a guaranteed [min, max] of fbm() over the axis-aligned box [boxMin, boxMax].
+	std::pair<_Float, _Float> fbm_range(
+	      const std::array<_Float, _Dimensions>& boxMin,
+	      const std::array<_Float, _Dimensions>& boxMax,
+	      uint32_t octaves,
+	      _Float lacunarity,
+	      _Float gain) const
+	{
+		double lo = 0, hi = 0;
+		_Float amplitude = 1, frequency = 1;
+		for (uint32_t o = 0; o < octaves; ++o)
+		{
+			std::array<_Float, _Dimensions> octaveMin, octaveMax;
+			for (uint32_t k = 0; k < _Dimensions; ++k)
+			{
+				octaveMin[k] = boxMin[k] * frequency;
+				octaveMax[k] = boxMax[k] * frequency;
+			}
+			std::pair<double, double> r = bounds_impl_t::range(permGrad, perm, octaveMin, octaveMax);
+			lo += amplitude * (amplitude < 0 ? r.second : r.first);
+			hi += amplitude * (amplitude < 0 ? r.first : r.second);
+			amplitude *= gain;
+			frequency *= lacunarity;
+		}
+		return { _Float(lo), _Float(hi) };
+	}
+
+	// Generates like generate(), but stores every value * scale + bias straight into a compact format, without a
+	// float intermediate: uint8_t and uint16_t clamp to their range and round to nearest, storing NaN as 0; Half and
+	// BFloat16 round to nearest even. For example, scale = bias = 127.5 maps [-1, 1] onto the full uint8_t range.
+	template<typename _Out>
+	void generate_quantized(
+	      _Out* out,
+	      const std::array<size_t, _Dimensions>& size,
+	      const std::array<_Float, _Dimensions>& origin,
+	      _Float step,
+	      _Float scale,
+	      _Float bias) const
+	{
+		grid_impl_t::generate_quantized(permGrad, perm, out, size, origin, step, scale, bias);
+	}
+
+	// Fills a width * height buffer, x varying fastest, with the noise sampled at (x0 + i * step, y0 + j * step).
+	// Evaluated with the fixed-point kernel and remapped from [-1, 1] to [0, 65535].
+	template<uint32_t _D = _Dimensions, std::enable_if_t<(_D == 2)>* = nullptr>
+	void generate_u16(uint16_t* out, size_t width, size_t height, double x0, double y0, double step) const
+	{
+		static_assert(!kernel_t::Pruned, "The fixed-point kernel has the default radius only");
+		_detail::noise_fixed_impl<_D>::template generate<_detail::noise_mode_impl<_D, Mode, _Mode>>(
+		      perm,
+		      out,
+		      width,
+		      height,
+		      x0,
+		      y0,
+		      step);
+	}
 };
 
 
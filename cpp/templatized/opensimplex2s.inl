@@ -49,6 +49,15 @@ namespace _detail
 			}
 			return *this;
 		}
+
+		constexpr grad<_Dimensions, _Float>& operator*=(_Float f)
+		{
+			for (size_t i = 0; i < _Dimensions; ++i)
+			{
+				v[i] *= f;
+			}
+			return *this;
+		}
 	};
 
 	template<uint32_t _Dimensions, typename _Float>
@@ -71,6 +80,107 @@ namespace _detail
 	};
 
 
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Kernel radius
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	constexpr double sqrt_constexpr(double x)
+	{
+		double r = x < 1 ? 1 : x;
+		for (int i = 0; i < 64; ++i)
+		{
+			r = (r + x / r) / 2;
+		}
+		return r;
+	}
+
+	// A kernel of squared radius r^2 below the default r0^2 leaves out the lattice points that cannot reach the part
+	// of the cell its table row is chosen by. Its gradients are scaled by (r0 / r)^9, the ratio of the two kernels'
+	// peaks (r^2 - d^2)^4 |d| at |d| = r / 3, which keeps the output within [-1, 1].
+	template<uint32_t _Dimensions, typename _RadiusSq>
+	struct kernel_traits
+	{
+		typedef typename kernel_radius<_Dimensions>::type default_t;
+
+		static constexpr bool Pruned = !std::ratio_equal<_RadiusSq, default_t>::value;
+		static constexpr double RadiusSq = double(_RadiusSq::num) / double(_RadiusSq::den);
+		static constexpr double DefaultRadiusSq = double(default_t::num) / double(default_t::den);
+		static constexpr double Shrink = DefaultRadiusSq / RadiusSq;
+		static constexpr double GradientScale = Shrink * Shrink * Shrink * Shrink * sqrt_constexpr(Shrink);
+
+		// The skew's unskewing factor: offsets in the noise's own lattice space are v + Unskew * sum(v).
+		static constexpr double Unskew = _Dimensions == 2 ? -0.211324865405187
+		                                 : _Dimensions == 3 ? 0
+		                                                    : -0.138196601125011;
+
+		// Whether a lattice point at skewed offset c from the cell's base can reach a sample whose skewed offset lies
+		// in the box [lo, hi]. The squared unskewed distance |y|^2 + q sum(y)^2, y = p - c, is convex, and among
+		// points with a given sum(y) the box's nearest to the origin is clamp(l, lo, hi) for some l. Between the
+		// box's bounds the distance is a quadratic in l, so its minimum is found exactly piece by piece.
+		static constexpr bool reaches(
+		      const std::array<double, _Dimensions>& lo,
+		      const std::array<double, _Dimensions>& hi,
+		      const std::array<double, _Dimensions>& c)
+		{
+			constexpr double q = 2 * Unskew + _Dimensions * Unskew * Unskew;
+			std::array<double, _Dimensions> ylo{}, yhi{};
+			std::array<double, 2 * _Dimensions> breaks{};
+			for (uint32_t k = 0; k < _Dimensions; ++k)
+			{
+				ylo[k] = lo[k] - c[k];
+				yhi[k] = hi[k] - c[k];
+				breaks[2 * k] = ylo[k];
+				breaks[2 * k + 1] = yhi[k];
+			}
+			for (size_t i = 1; i < breaks.size(); ++i)
+			{
+				for (size_t j = i; j > 0 && breaks[j] < breaks[j - 1]; --j)
+				{
+					double b = breaks[j];
+					breaks[j] = breaks[j - 1];
+					breaks[j - 1] = b;
+				}
+			}
+
+			auto distance_sq = [&](double l) {
+				double sum = 0, sumSq = 0;
+				for (uint32_t k = 0; k < _Dimensions; ++k)
+				{
+					double y = l < ylo[k] ? ylo[k] : l > yhi[k] ? yhi[k] : l;
+					sum += y;
+					sumSq += y * y;
+				}
+				return sumSq + q * sum * sum;
+			};
+
+			double nearest = std::min(distance_sq(breaks.front()), distance_sq(breaks.back()));
+			for (size_t i = 0; i + 1 < breaks.size(); ++i)
+			{
+				// Coordinates whose bounds enclose the piece follow l; the others are fixed at a bound.
+				double fixedSum = 0, mid = (breaks[i] + breaks[i + 1]) / 2;
+				uint32_t freeCount = 0;
+				for (uint32_t k = 0; k < _Dimensions; ++k)
+				{
+					if (ylo[k] < mid && mid < yhi[k])
+					{
+						freeCount += 1;
+					}
+					else
+					{
+						fixedSum += mid < ylo[k] ? ylo[k] : yhi[k];
+					}
+				}
+				double l = -q * fixedSum / (1 + q * freeCount);
+				l = l < breaks[i] ? breaks[i] : l > breaks[i + 1] ? breaks[i + 1] : l;
+				nearest = std::min(nearest, distance_sq(l));
+			}
+
+			// Leave a margin for the rounding of the sample's offsets.
+			return nearest < RadiusSq + 1e-6;
+		}
+	};
+
+
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// 2D specialization code
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -78,33 +188,47 @@ namespace _detail
 	template<>
 	struct noise_mode_impl<2, Mode, Mode::Standard_2D>
 	{
-		template<typename _Float, typename _Int>
+		template<typename _Float, typename _Int, typename _RadiusSq>
 		static constexpr _Float eval(
 		      const std::array<grad<2, _Float>, PSIZE>& grads,
 		      const std::array<uint16_t, PSIZE>& perm,
 		      _Float x,
 		      _Float y)
+		{
+			std::array<_Float, 2> t = transform(x, y);
+			return _detail::noise_impl<2, _Float, _Int, _RadiusSq>::eval(grads, perm, t[0], t[1]);
+		}
+
+		template<typename _Float>
+		static constexpr std::array<_Float, 2> transform(_Float x, _Float y)
 		{
 			_Float s = _Float(0.366025403784439) * (x + y);
 			_Float xs = x + s;
 			_Float ys = y + s;
-			return _detail::noise_impl<2, _Float, _Int>::eval(grads, perm, xs, ys);
+			return { xs, ys };
 		}
 	};
 
 	template<>
 	struct noise_mode_impl<2, Mode, Mode::XBeforeY_2D>
 	{
-		template<typename _Float, typename _Int>
+		template<typename _Float, typename _Int, typename _RadiusSq>
 		static constexpr _Float eval(
 		      const std::array<grad<2, _Float>, PSIZE>& grads,
 		      const std::array<uint16_t, PSIZE>& perm,
 		      _Float x,
 		      _Float y)
+		{
+			std::array<_Float, 2> t = transform(x, y);
+			return _detail::noise_impl<2, _Float, _Int, _RadiusSq>::eval(grads, perm, t[0], t[1]);
+		}
+
+		template<typename _Float>
+		static constexpr std::array<_Float, 2> transform(_Float x, _Float y)
 		{
 			_Float xx = x * 0.7071067811865476;
 			_Float yy = y * 1.224744871380249;
-			return _detail::noise_impl<2, _Float, _Int>::eval(grads, perm, yy + xx, yy - xx);
+			return { yy + xx, yy - xx };
 		}
 	};
 
@@ -244,16 +368,179 @@ namespace _detail
 	};
 
 
-	template<typename _Float, typename _Int>
-	struct noise_impl<2, _Float, _Int>
+	// Bounding box { x0, y0, x1, y1 } of the part of the unit square where n . p >= k for each plane { n, k }.
+	template<size_t _N>
+	constexpr std::array<double, 4> clipped_square_bounds(const std::array<std::array<double, 3>, _N>& planes)
+	{
+		std::array<std::array<double, 2>, 4 + _N> polygon{ { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } } };
+		size_t count = 4;
+		for (const std::array<double, 3>& plane : planes)
+		{
+			std::array<std::array<double, 2>, 4 + _N> clipped{};
+			size_t clippedCount = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				const std::array<double, 2>& p = polygon[i];
+				const std::array<double, 2>& q = polygon[(i + 1) % count];
+				double dp = plane[0] * p[0] + plane[1] * p[1] - plane[2];
+				double dq = plane[0] * q[0] + plane[1] * q[1] - plane[2];
+				if (dp >= 0)
+				{
+					clipped[clippedCount++] = p;
+				}
+				if ((dp >= 0) != (dq >= 0))
+				{
+					double t = dp / (dp - dq);
+					clipped[clippedCount++] = { p[0] + t * (q[0] - p[0]), p[1] + t * (q[1] - p[1]) };
+				}
+			}
+			polygon = clipped;
+			count = clippedCount;
+		}
+
+		std::array<double, 4> bounds{ 1, 1, 0, 0 };
+		for (size_t i = 0; i < count; ++i)
+		{
+			bounds[0] = std::min(bounds[0], polygon[i][0]);
+			bounds[1] = std::min(bounds[1], polygon[i][1]);
+			bounds[2] = std::max(bounds[2], polygon[i][0]);
+			bounds[3] = std::max(bounds[3], polygon[i][1]);
+		}
+		return bounds;
+	}
+
+	// Each group of four points serves one region of the cell, picked by three index bits; points out of reach of
+	// the whole region are dropped and the rest moved to the front of their group.
+	template<typename _Float, typename _Int, typename _RadiusSq>
+	struct pruned_lattice<2, _Float, _Int, _RadiusSq>
+	{
+		typedef lattice_point<2, _Float, _Int> lattice_point_t;
+
+		// Where each kept point is in the unpruned list.
+		struct table_t
+		{
+			std::array<uint8_t, 8 * 4> order;
+			std::array<uint8_t, 8> counts;
+		};
+
+		static constexpr table_t init()
+		{
+			table_t table{};
+			for (uint32_t region = 0; region < 8; ++region)
+			{
+				// Bit 0 tests x + y >= 1, bits 1 and 2 x - y / 2 >= a / 2 and y - x / 2 >= a / 2 for a bit 0.
+				double a = region & 1;
+				std::array<std::array<double, 3>, 3> planes{ { { 1, 1, 1 }, { 1, -0.5, a / 2 }, { -0.5, 1, a / 2 } } };
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					if (((region >> k) & 1) == 0)
+					{
+						planes[k] = { -planes[k][0], -planes[k][1], -planes[k][2] };
+					}
+				}
+				std::array<double, 4> bounds = clipped_square_bounds(planes);
+
+				uint8_t& count = table.counts[region];
+				for (uint32_t i = 0; i < 4; ++i)
+				{
+					const lattice_point_t& c = pregen_lattice<2, _Float, _Int>::points[region * 4 + i];
+					if (kernel_traits<2, _RadiusSq>::reaches(
+					          { bounds[0], bounds[1] },
+					          { bounds[2], bounds[3] },
+					          { double(c.xsv), double(c.ysv) }))
+					{
+						table.order[region * 4 + count++] = uint8_t(region * 4 + i);
+					}
+				}
+			}
+			return table;
+		}
+
+		static constexpr table_t table{ init() };
+
+		template<size_t... _I>
+		static constexpr std::array<lattice_point_t, sizeof...(_I)> gather(std::index_sequence<_I...>)
+		{
+			return { pregen_lattice<2, _Float, _Int>::points[table.order[_I]]... };
+		}
+
+		static constexpr std::array<lattice_point_t, 8 * 4> points{ gather(std::make_index_sequence<8 * 4>()) };
+		static constexpr std::array<uint8_t, 8> counts{ table.counts };
+	};
+
+
+	template<typename _Float, typename _Int, typename _RadiusSq>
+	struct noise_impl<2, _Float, _Int, _RadiusSq>
 	{
+		typedef kernel_traits<2, _RadiusSq> kernel_t;
+		typedef std::conditional_t<
+		      kernel_t::Pruned,
+		      pruned_lattice<2, _Float, _Int, _RadiusSq>,
+		      pregen_lattice<2, _Float, _Int>>
+		      lattice_t;
+
 		static constexpr _Float eval(
 		      const std::array<grad<2, _Float>, PSIZE>& grads,
 		      const std::array<uint16_t, PSIZE>& perm,
 		      _Float xs,
 		      _Float ys)
+		{
+			return eval_with(
+			      [&](const lattice_point<2, _Float, _Int>& c, _Int xsb, _Int ysb) -> const grad<2, _Float>& {
+				      _Int pxm = (xsb + c.xsv) & PMASK, pym = (ysb + c.ysv) & PMASK;
+				      return grads[perm[pxm] ^ pym];
+			      },
+			      xs,
+			      ys);
+		}
+
+		// Evaluates with gradient(c, xsb, ysb) supplying the gradient of lattice point c of the cell at (xsb, ysb).
+		template<typename _Gradient>
+		static constexpr _Float eval_with(const _Gradient& gradient, _Float xs, _Float ys)
 		{
 			_Float value = 0;
+			for_each_contribution(
+			      [&](const lattice_point<2, _Float, _Int>& c, _Int xsb, _Int ysb, _Float dx, _Float dy, _Float attn) {
+				      const grad<2, _Float>& g = gradient(c, xsb, ysb);
+				      _Float extrapolation = g.v[0] * dx + g.v[1] * dy;
+
+				      attn *= attn;
+				      value += attn * attn * extrapolation;
+			      },
+			      xs,
+			      ys);
+			return value;
+		}
+
+		// Disc output: each lattice point applies a random scaled rotation to its offset instead of projecting it on
+		// a gradient. The rotation's first row is the gradient, so component 0 is eval(); the second is the gradient
+		// turned a quarter, which leaves the components uncorrelated and the output's direction uniform.
+		static constexpr std::array<_Float, 2> eval_vector(
+		      const std::array<grad<2, _Float>, PSIZE>& grads,
+		      const std::array<uint16_t, PSIZE>& perm,
+		      _Float xs,
+		      _Float ys)
+		{
+			std::array<_Float, 2> value{};
+			for_each_contribution(
+			      [&](const lattice_point<2, _Float, _Int>& c, _Int xsb, _Int ysb, _Float dx, _Float dy, _Float attn) {
+				      const grad<2, _Float>& g = grads[perm[(xsb + c.xsv) & PMASK] ^ ((ysb + c.ysv) & PMASK)];
+				      attn *= attn;
+				      attn *= attn;
+				      value[0] += attn * (g.v[0] * dx + g.v[1] * dy);
+				      value[1] += attn * (g.v[0] * dy - g.v[1] * dx);
+			      },
+			      xs,
+			      ys);
+			return value;
+		}
+
+		// Calls contribute(c, xsb, ysb, dx, dy, attn) for every lattice point c in range of (xs, ys), where
+		// (xsb, ysb) is the cell, (dx, dy) the unskewed offset from c and attn the unraised falloff.
+		template<typename _Contribute>
+		static constexpr void for_each_contribution(const _Contribute& contribute, _Float xs, _Float ys)
+		{
+			OSN_COUNT(evaluations2D);
 
 			// Get base points and offsets
 			_Int xsb = fastFloor<_Float, _Int>(xs);
@@ -270,25 +557,169 @@ namespace _detail
 			_Float xi = xsi + ssi, yi = ysi + ssi;
 
 			// Point contributions
-			for (uint32_t i = 0; i < 4; i += 1)
+			uint32_t count = 4;
+			if constexpr (kernel_t::Pruned)
 			{
-				lattice_point<2, _Float, _Int> c = pregen_lattice<2, _Float, _Int>::points[index + i];
+				count = lattice_t::counts[index >> 2];
+			}
+			for (uint32_t i = 0; i < count; i += 1)
+			{
+				lattice_point<2, _Float, _Int> c = lattice_t::points[index + i];
+				OSN_COUNT(candidates2D);
 
 				_Float dx = xi + c.dx, dy = yi + c.dy;
-				_Float attn = _Float(2) / _Float(3) - dx * dx - dy * dy;
+				_Float attn = _Float(_RadiusSq::num) / _Float(_RadiusSq::den) - dx * dx - dy * dy;
 				if (attn <= 0)
 					continue;
+				OSN_COUNT(contributions2D);
+
+				contribute(c, xsb, ysb, dx, dy, attn);
+			}
+		}
+	};
+
+
+	// Fixed-point 2D kernel
+	// Positions are unsigned Q32 skewed coordinates, which wrap at 2^32 lattice units (a multiple of PSIZE).
+	// Offsets are Q12, squared distances and attenuation Q24, falloff Q15 and gradients Q10.
+	// The accumulated value is Q27.
 
-				_Int pxm = (xsb + c.xsv) & PMASK, pym = (ysb + c.ysv) & PMASK;
-				grad<2, _Float> g = grads[perm[pxm] ^ pym];
-				_Float extrapolation = g.v[0] * dx + g.v[1] * dy;
+	template<typename _Int, typename _Float>
+	inline constexpr _Int fixedRound(_Float x, uint32_t fractionBits)
+	{
+		_Float scaled = x * _Float(int64_t(1) << fractionBits);
+		return _Int(scaled < 0 ? scaled - _Float(0.5) : scaled + _Float(0.5));
+	}
 
-				attn *= attn;
-				value += attn * attn * extrapolation;
+	template<>
+	struct lattice_point_fixed<2>
+	{
+		int16_t xsv, ysv;
+		int16_t dx, dy;
+	};
+
+	template<>
+	struct pregen_fixed_initializer<2>
+	{
+		typedef grad<2, int16_t> grad_t;
+		typedef pregen_gradients_list<2, double> gradients_t;
+		typedef pregen_lattice<2, double, int32_t> lattice_t;
+
+		template<size_t... _I>
+		static constexpr auto grads(std::index_sequence<_I...>)
+		{
+			return std::array<grad_t, sizeof...(_I)>{ grad_t(fixedRound<int16_t>(gradients_t::grads[_I].v[0], 10),
+				                                             fixedRound<int16_t>(gradients_t::grads[_I].v[1], 10))... };
+		}
+
+		template<size_t... _I>
+		static constexpr auto points(std::index_sequence<_I...>)
+		{
+			return std::array<lattice_point_fixed<2>, sizeof...(_I)>{ lattice_point_fixed<2>{
+				  int16_t(lattice_t::points[_I].xsv),
+				  int16_t(lattice_t::points[_I].ysv),
+				  fixedRound<int16_t>(lattice_t::points[_I].dx, 12),
+				  fixedRound<int16_t>(lattice_t::points[_I].dy, 12) }... };
+		}
+	};
+
+	template<>
+	struct pregen_gradients_fixed<2>
+	{
+		static constexpr auto grads{ pregen_fixed_initializer<2>::grads(
+			  std::make_index_sequence<pregen_gradients_list<2, double>::n_grads>{}) };
+	};
+
+	template<>
+	struct pregen_lattice_fixed<2>
+	{
+		static constexpr auto points{ pregen_fixed_initializer<2>::points(
+			  std::make_index_sequence<pregen_lattice<2, double, int32_t>::points.size()>{}) };
+	};
+
+	template<>
+	struct noise_fixed_impl<2>
+	{
+		static constexpr int32_t One = 1 << 12;
+		static constexpr int32_t Unskew = fixedRound<int32_t>(-0.211324865405187, 15);
+		static constexpr int32_t RadiusSq = fixedRound<int32_t>(2.0 / 3.0, 24);
+
+		// 32.32 fixed point of v, reduced first to the PSIZE cells the hash reads, which leaves the noise unchanged and
+		// keeps the conversion in range for any v. NaN and infinities become 0.
+		static inline uint64_t toFixed(double v)
+		{
+			double r = std::fmod(v, double(PSIZE));
+			r = r < 0 ? r + double(PSIZE) : r;
+			return r == r ? uint64_t(std::floor(r * 4294967296.0)) : 0;
+		}
+
+		static constexpr int32_t eval(const std::array<uint16_t, PSIZE>& perm, uint64_t xs, uint64_t ys)
+		{
+			int32_t value = 0;
+
+			// Get base points and offsets
+			uint32_t xsb = uint32_t(xs >> 32);
+			uint32_t ysb = uint32_t(ys >> 32);
+			int32_t xsi = int32_t((xs >> 20) & (One - 1)), ysi = int32_t((ys >> 20) & (One - 1));
+
+			// Index to point list
+			int32_t a = (xsi + ysi) >= One ? 1 : 0;
+			int32_t index = (a << 2) | ((2 * xsi - ysi - a * One >= 0 ? 1 : 0) << 3)
+			                | ((2 * ysi - xsi - a * One >= 0 ? 1 : 0) << 4);
+
+			int32_t ssi = ((xsi + ysi) * Unskew) >> 15;
+			int32_t xi = xsi + ssi, yi = ysi + ssi;
+
+			// Point contributions
+			for (uint32_t i = 0; i < 4; i += 1)
+			{
+				const lattice_point_fixed<2>& c = pregen_lattice_fixed<2>::points[index + i];
+
+				int32_t dx = xi + c.dx, dy = yi + c.dy;
+				int32_t attn = RadiusSq - dx * dx - dy * dy;
+				if (attn <= 0)
+					continue;
+
+				uint32_t pxm = (xsb + uint32_t(c.xsv)) & PMASK, pym = (ysb + uint32_t(c.ysv)) & PMASK;
+				const grad<2, int16_t>& g =
+				      pregen_gradients_fixed<2>::grads[perm[perm[pxm] ^ pym] % pregen_gradients_fixed<2>::grads.size()];
+				int32_t extrapolation = (g.v[0] * dx + g.v[1] * dy) >> 10;
+
+				attn >>= 9;
+				attn = (attn * attn) >> 15;
+				attn = (attn * attn) >> 15;
+				value += attn * extrapolation;
 			}
 
 			return value;
 		}
+
+		template<typename _ModeImpl>
+		static void generate(
+		      const std::array<uint16_t, PSIZE>& perm,
+		      uint16_t* out,
+		      size_t width,
+		      size_t height,
+		      double x0,
+		      double y0,
+		      double step)
+		{
+			// Both 2D orientations are linear, so the skewed coordinates can be stepped along each row.
+			std::array<double, 2> di = _ModeImpl::transform(step, 0.0);
+			uint64_t dxs = toFixed(di[0]), dys = toFixed(di[1]);
+
+			for (size_t j = 0; j < height; ++j)
+			{
+				std::array<double, 2> t = _ModeImpl::transform(x0, y0 + double(j) * step);
+				uint64_t xs = toFixed(t[0]), ys = toFixed(t[1]);
+
+				for (size_t i = 0; i < width; ++i, xs += dxs, ys += dys)
+				{
+					int32_t v = (eval(perm, xs, ys) + (1 << 27)) >> 12;
+					*out++ = uint16_t(std::min(std::max(v, int32_t(0)), int32_t(65535)));
+				}
+			}
+		}
 	};
 
 
@@ -299,13 +730,22 @@ namespace _detail
 	template<>
 	struct noise_mode_impl<3, Mode, Mode::Classic_3D>
 	{
-		template<typename _Float, typename _Int>
+		template<typename _Float, typename _Int, typename _RadiusSq>
 		static constexpr _Float eval(
 		      const std::array<grad<3, _Float>, PSIZE>& grads,
 		      const std::array<uint16_t, PSIZE>& perm,
 		      _Float x,
 		      _Float y,
 		      _Float z)
+		{
+			std::array<_Float, 3> t = transform(x, y, z);
+
+			// Evaluate both lattices to form a BCC lattice.
+			return _detail::noise_impl<3, _Float, _Int, _RadiusSq>::eval(grads, perm, t[0], t[1], t[2]);
+		}
+
+		template<typename _Float>
+		static constexpr std::array<_Float, 3> transform(_Float x, _Float y, _Float z)
 		{
 			// Re-orient the cubic lattices via rotation, to produce the expected look on cardinal planar slices.
 			// If texturing objects that don't tend to have cardinal plane faces, you could even remove this.
@@ -315,21 +755,29 @@ namespace _detail
 			_Float yr = r - y;
 			_Float zr = r - z;
 
-			// Evaluate both lattices to form a BCC lattice.
-			return _detail::noise_impl<3, _Float, _Int>::eval(grads, perm, xr, yr, zr);
+			return { xr, yr, zr };
 		}
 	};
 
 	template<>
 	struct noise_mode_impl<3, Mode, Mode::XYBeforeZ_3D>
 	{
-		template<typename _Float, typename _Int>
+		template<typename _Float, typename _Int, typename _RadiusSq>
 		static constexpr _Float eval(
 		      const std::array<grad<3, _Float>, PSIZE>& grads,
 		      const std::array<uint16_t, PSIZE>& perm,
 		      _Float x,
 		      _Float y,
 		      _Float z)
+		{
+			std::array<_Float, 3> t = transform(x, y, z);
+
+			// Evaluate both lattices to form a BCC lattice.
+			return _detail::noise_impl<3, _Float, _Int, _RadiusSq>::eval(grads, perm, t[0], t[1], t[2]);
+		}
+
+		template<typename _Float>
+		static constexpr std::array<_Float, 3> transform(_Float x, _Float y, _Float z)
 		{
 			// Re-orient the cubic lattices without skewing, to make X and Y triangular like 2D.
 			// Orthonormal rotation. Not a skew transform.
@@ -339,21 +787,29 @@ namespace _detail
 			_Float xr = x + s2 - zz, yr = y + s2 - zz;
 			_Float zr = xy * _Float(0.577350269189626) + zz;
 
-			// Evaluate both lattices to form a BCC lattice.
-			return _detail::noise_impl<3, _Float, _Int>::eval(grads, perm, xr, yr, zr);
+			return { xr, yr, zr };
 		}
 	};
 
 	template<>
 	struct noise_mode_impl<3, Mode, Mode::XZBeforeY_3D>
 	{
-		template<typename _Float, typename _Int>
+		template<typename _Float, typename _Int, typename _RadiusSq>
 		static constexpr _Float eval(
 		      const std::array<grad<3, _Float>, PSIZE>& grads,
 		      const std::array<uint16_t, PSIZE>& perm,
 		      _Float x,
 		      _Float y,
 		      _Float z)
+		{
+			std::array<_Float, 3> t = transform(x, y, z);
+
+			// Evaluate both lattices to form a BCC lattice.
+			return _detail::noise_impl<3, _Float, _Int, _RadiusSq>::eval(grads, perm, t[0], t[1], t[2]);
+		}
+
+		template<typename _Float>
+		static constexpr std::array<_Float, 3> transform(_Float x, _Float y, _Float z)
 		{
 			// Re-orient the cubic lattices without skewing, to make X and Z triangular like 2D.
 			// Orthonormal rotation. Not a skew transform.
@@ -364,8 +820,7 @@ namespace _detail
 			_Float yr = xz * _Float(0.577350269189626) + yy;
 			_Float zr = z + s2 - yy;
 
-			// Evaluate both lattices to form a BCC lattice.
-			return _detail::noise_impl<3, _Float, _Int>::eval(grads, perm, xr, yr, zr);
+			return { xr, yr, zr };
 		}
 	};
 
@@ -459,10 +914,12 @@ namespace _detail
 	{
 		typedef lattice_point<3, _Float, _Int> lattice_point_t;
 
+		// Entry n is built for octant n, so the recursion starts at the _N it was given. Starting one further on
+		// paired each octant with its neighbour's points and made 3D noise jump across every cell boundary.
 		static constexpr auto init()
 		{
-			return pregen_lattice_list_initializer<_N + 1, 3, _Float, _Int>::
-			      template initr<>(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12);
+			return pregen_lattice_list_initializer<_N, 3, _Float, _Int>::template initr<>(
+			      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12);
 		}
 
 		template<typename... _F, class = std::common_type<_F...>>
@@ -574,9 +1031,68 @@ namespace _detail
 	};
 
 
-	template<typename _Float, typename _Int>
-	struct noise_impl<3, _Float, _Int>
+	// The points each of the cube's 64 boxes of side 1/4 can reach, taken in block order from its octant's and stored
+	// per box. The default radius walks the blocks with the skip lists below instead, which only hold for it, but the
+	// octants are too coarse to prune by: a smaller kernel's octant still meets all of its 14 points.
+	template<typename _Float, typename _Int, typename _RadiusSq>
+	struct pruned_lattice<3, _Float, _Int, _RadiusSq>
 	{
+		typedef lattice_point<3, _Float, _Int> lattice_point_t;
+
+		// Where each kept point is in the unpruned list.
+		struct table_t
+		{
+			std::array<uint8_t, 64 * 14> order;
+			std::array<uint8_t, 64> counts;
+		};
+
+		static constexpr table_t init()
+		{
+			table_t table{};
+			for (uint32_t box = 0; box < 64; ++box)
+			{
+				std::array<double, 3> lo{}, hi{};
+				uint32_t octant = 0;
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					uint32_t quarter = (box >> (2 * k)) & 3;
+					lo[k] = quarter * 0.25;
+					hi[k] = lo[k] + 0.25;
+					octant |= (quarter >> 1) << k;
+				}
+
+				uint8_t& count = table.counts[box];
+				for (uint32_t block = 0; block < 14; ++block)
+				{
+					const lattice_point_t& c = pregen_lattice<3, _Float, _Int>::points[octant + block * 8];
+					std::array<double, 3> offset{ -double(c.dxr), -double(c.dyr), -double(c.dzr) };
+					if (kernel_traits<3, _RadiusSq>::reaches(lo, hi, offset))
+					{
+						table.order[box * 14 + count++] = uint8_t(octant + block * 8);
+					}
+				}
+			}
+			return table;
+		}
+
+		static constexpr table_t table{ init() };
+
+		template<size_t... _I>
+		static constexpr std::array<lattice_point_t, sizeof...(_I)> gather(std::index_sequence<_I...>)
+		{
+			return { pregen_lattice<3, _Float, _Int>::points[table.order[_I]]... };
+		}
+
+		static constexpr std::array<lattice_point_t, 64 * 14> points{ gather(std::make_index_sequence<64 * 14>()) };
+		static constexpr std::array<uint8_t, 64> counts{ table.counts };
+	};
+
+
+	template<typename _Float, typename _Int, typename _RadiusSq>
+	struct noise_impl<3, _Float, _Int, _RadiusSq>
+	{
+		typedef kernel_traits<3, _RadiusSq> kernel_t;
+
 		static constexpr std::array<uint8_t, 14> NextLatticeIndexBlockFailure{ 1, 2,   3,   4,   5,   6,   7,
 			                                                                   8, 0x9, 0xA, 0xB, 0xC, 0xD, 0xff };
 		static constexpr std::array<uint8_t, 14> NextLatticeIndexBlockSuccess{ 1, 2,   5,   4,   6,   6,    9,
@@ -589,6 +1105,107 @@ namespace _detail
 		      _Float yr,
 		      _Float zr)
 		{
+			return eval_with(
+			      [&](const lattice_point<3, _Float, _Int>& c, _Int xrb, _Int yrb, _Int zrb) -> const grad<3, _Float>& {
+				      _Int pxm = (xrb + c.xrv) & PMASK;
+				      _Int pym = (yrb + c.yrv) & PMASK;
+				      _Int pzm = (zrb + c.zrv) & PMASK;
+				      return grads[perm[perm[pxm] ^ pym] ^ pzm];
+			      },
+			      xr,
+			      yr,
+			      zr);
+		}
+
+		// Evaluates with gradient(c, xrb, yrb, zrb) supplying the gradient of lattice point c of the cube at
+		// (xrb, yrb, zrb).
+		template<typename _Gradient>
+		static constexpr _Float eval_with(const _Gradient& gradient, _Float xr, _Float yr, _Float zr)
+		{
+			_Float value = 0;
+			for_each_contribution(
+			      [&](const lattice_point<3, _Float, _Int>& c,
+			          _Int xrb,
+			          _Int yrb,
+			          _Int zrb,
+			          _Float dxr,
+			          _Float dyr,
+			          _Float dzr,
+			          _Float attn) {
+				      const grad<3, _Float>& g = gradient(c, xrb, yrb, zrb);
+				      _Float extrapolation = g.v[0] * dxr + g.v[1] * dyr + g.v[2] * dzr;
+
+				      attn *= attn;
+				      value += attn * attn * extrapolation;
+			      },
+			      xr,
+			      yr,
+			      zr);
+			return value;
+		}
+
+		// Ball output, as noise_impl<2>::eval_vector: the rotation's rows are the gradient g, g x u rescaled to the
+		// shared gradient length, and g x (g x u) likewise, for u the gradient hashed once more through perm. If u is
+		// parallel to g, g's cyclically shifted coordinates stand in for it.
+		static std::array<_Float, 3> eval_vector(
+		      const std::array<grad<3, _Float>, PSIZE>& grads,
+		      const std::array<uint16_t, PSIZE>& perm,
+		      _Float xr,
+		      _Float yr,
+		      _Float zr)
+		{
+			std::array<_Float, 3> value{};
+			for_each_contribution(
+			      [&](const lattice_point<3, _Float, _Int>& c,
+			          _Int xrb,
+			          _Int yrb,
+			          _Int zrb,
+			          _Float dxr,
+			          _Float dyr,
+			          _Float dzr,
+			          _Float attn) {
+				      _Int pxm = (xrb + c.xrv) & PMASK;
+				      _Int pym = (yrb + c.yrv) & PMASK;
+				      _Int pzm = (zrb + c.zrv) & PMASK;
+				      _Int h = perm[perm[pxm] ^ pym] ^ pzm;
+				      std::array<_Float, 3> g{ grads[h].v[0], grads[h].v[1], grads[h].v[2] };
+				      std::array<_Float, 3> u{ grads[perm[h]].v[0], grads[perm[h]].v[1], grads[perm[h]].v[2] };
+				      std::array<_Float, 3> a = cross(g, u);
+				      _Float gg = g[0] * g[0] + g[1] * g[1] + g[2] * g[2], aa = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+				      if (aa < gg * gg * _Float(1e-4))
+				      {
+					      a = cross(g, { g[1], g[2], g[0] });
+					      aa = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+				      }
+				      _Float scale = std::sqrt(gg / aa);
+				      a = { a[0] * scale, a[1] * scale, a[2] * scale };
+				      std::array<_Float, 3> b = cross(g, a);
+				      scale = 1 / std::sqrt(gg);
+
+				      attn *= attn;
+				      attn *= attn;
+				      value[0] += attn * (g[0] * dxr + g[1] * dyr + g[2] * dzr);
+				      value[1] += attn * (a[0] * dxr + a[1] * dyr + a[2] * dzr);
+				      value[2] += attn * scale * (b[0] * dxr + b[1] * dyr + b[2] * dzr);
+			      },
+			      xr,
+			      yr,
+			      zr);
+			return value;
+		}
+
+		static constexpr std::array<_Float, 3> cross(const std::array<_Float, 3>& a, const std::array<_Float, 3>& b)
+		{
+			return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+		}
+
+		// Calls contribute(c, xrb, yrb, zrb, dxr, dyr, dzr, attn) for every lattice point c in range of (xr, yr, zr),
+		// where (xrb, yrb, zrb) is the cube, (dxr, dyr, dzr) the offset from c and attn the unraised falloff.
+		template<typename _Contribute>
+		static constexpr void for_each_contribution(const _Contribute& contribute, _Float xr, _Float yr, _Float zr)
+		{
+			OSN_COUNT(evaluations3D);
+
 			// Get base and offsets inside cube of first lattice.
 			_Int xrb = fastFloor<_Float, _Int>(xr);
 			_Int yrb = fastFloor<_Float, _Int>(yr);
@@ -603,35 +1220,52 @@ namespace _detail
 			_Int index = (xht << 0) | (yht << 1) | (zht << 2);
 
 			// Point contributions
-			_Float value = 0;
+			if constexpr (kernel_t::Pruned)
+			{
+				typedef pruned_lattice<3, _Float, _Int, _RadiusSq> lattice_t;
+				// An offset just below a whole cell rounds up to 1 in float, still inside the last quarter.
+				_Int box = (std::min(_Int(xri * 4), _Int(3)) << 0) | (std::min(_Int(yri * 4), _Int(3)) << 2)
+				           | (std::min(_Int(zri * 4), _Int(3)) << 4);
+				for (uint32_t i = 0; i < lattice_t::counts[box]; i += 1)
+				{
+					const lattice_point<3, _Float, _Int>& c = lattice_t::points[box * 14 + i];
+					OSN_COUNT(candidates3D);
+					_Float dxr = xri + c.dxr;
+					_Float dyr = yri + c.dyr;
+					_Float dzr = zri + c.dzr;
+					_Float attn = _Float(_RadiusSq::num) / _Float(_RadiusSq::den) - dxr * dxr - dyr * dyr - dzr * dzr;
+					if (attn >= 0)
+					{
+						OSN_COUNT(contributions3D);
+						contribute(c, xrb, yrb, zrb, dxr, dyr, dzr, attn);
+					}
+				}
+				return;
+			}
 
 			_Int block = 0;
 
 			while (block != 0xff)
 			{
 				lattice_point<3, _Float, _Int> c = pregen_lattice<3, _Float, _Int>::points[index + block * 8];
+				OSN_COUNT(candidates3D);
 				_Float dxr = xri + c.dxr;
 				_Float dyr = yri + c.dyr;
 				_Float dzr = zri + c.dzr;
 				_Float attn = _Float(0.75) - dxr * dxr - dyr * dyr - dzr * dzr;
 				if (attn < 0)
 				{
+					OSN_COUNT(blockFailure[block]);
 					block = NextLatticeIndexBlockFailure[block];
 				}
 				else
 				{
-					_Int pxm = (xrb + c.xrv) & PMASK;
-					_Int pym = (yrb + c.yrv) & PMASK;
-					_Int pzm = (zrb + c.zrv) & PMASK;
-					grad<3, _Float> grad = grads[perm[perm[pxm] ^ pym] ^ pzm];
-					_Float extrapolation = grad.v[0] * dxr + grad.v[1] * dyr + grad.v[2] * dzr;
-
-					attn *= attn;
-					value += attn * attn * extrapolation;
+					OSN_COUNT(contributions3D);
+					OSN_COUNT(blockSuccess[block]);
+					contribute(c, xrb, yrb, zrb, dxr, dyr, dzr, attn);
 					block = NextLatticeIndexBlockSuccess[block];
 				}
 			}
-			return value;
 		}
 	};
 
@@ -643,7 +1277,7 @@ namespace _detail
 	template<>
 	struct noise_mode_impl<4, Mode, Mode::Classic_4D>
 	{
-		template<typename _Float, typename _Int>
+		template<typename _Float, typename _Int, typename _RadiusSq>
 		static constexpr _Float eval(
 		      const std::array<grad<4, _Float>, PSIZE>& grads,
 		      const std::array<uint16_t, PSIZE>& perm,
@@ -651,6 +1285,13 @@ namespace _detail
 		      _Float y,
 		      _Float z,
 		      _Float w)
+		{
+			std::array<_Float, 4> t = transform(x, y, z, w);
+			return _detail::noise_impl<4, _Float, _Int, _RadiusSq>::eval(grads, perm, t[0], t[1], t[2], t[3]);
+		}
+
+		template<typename _Float>
+		static constexpr std::array<_Float, 4> transform(_Float x, _Float y, _Float z, _Float w)
 		{
 			// Get points for A4 lattice
 			_Float s = _Float(0.309016994374947) * (x + y + z + w);
@@ -659,14 +1300,14 @@ namespace _detail
 			_Float zs = z + s;
 			_Float ws = w + s;
 
-			return _detail::noise_impl<4, _Float, _Int>::eval(grads, perm, xs, ys, zs, ws);
+			return { xs, ys, zs, ws };
 		}
 	};
 
 	template<>
 	struct noise_mode_impl<4, Mode, Mode::XYBeforeZW_4D>
 	{
-		template<typename _Float, typename _Int>
+		template<typename _Float, typename _Int, typename _RadiusSq>
 		static constexpr _Float eval(
 		      const std::array<grad<4, _Float>, PSIZE>& grads,
 		      const std::array<uint16_t, PSIZE>& perm,
@@ -674,6 +1315,13 @@ namespace _detail
 		      _Float y,
 		      _Float z,
 		      _Float w)
+		{
+			std::array<_Float, 4> t = transform(x, y, z, w);
+			return _detail::noise_impl<4, _Float, _Int, _RadiusSq>::eval(grads, perm, t[0], t[1], t[2], t[3]);
+		}
+
+		template<typename _Float>
+		static constexpr std::array<_Float, 4> transform(_Float x, _Float y, _Float z, _Float w)
 		{
 			_Float s2 = (x + y) * _Float(-0.28522513987434876941) + (z + w) * _Float(0.83897065470611435718);
 			_Float t2 = (z + w) * _Float(0.21939749883706435719) + (x + y) * _Float(-0.48214856493302476942);
@@ -682,14 +1330,14 @@ namespace _detail
 			_Float zs = z + t2;
 			_Float ws = w + t2;
 
-			return _detail::noise_impl<4, _Float, _Int>::eval(grads, perm, xs, ys, zs, ws);
+			return { xs, ys, zs, ws };
 		}
 	};
 
 	template<>
 	struct noise_mode_impl<4, Mode, Mode::XZBeforeYW_4D>
 	{
-		template<typename _Float, typename _Int>
+		template<typename _Float, typename _Int, typename _RadiusSq>
 		static constexpr _Float eval(
 		      const std::array<grad<4, _Float>, PSIZE>& grads,
 		      const std::array<uint16_t, PSIZE>& perm,
@@ -697,6 +1345,13 @@ namespace _detail
 		      _Float y,
 		      _Float z,
 		      _Float w)
+		{
+			std::array<_Float, 4> t = transform(x, y, z, w);
+			return _detail::noise_impl<4, _Float, _Int, _RadiusSq>::eval(grads, perm, t[0], t[1], t[2], t[3]);
+		}
+
+		template<typename _Float>
+		static constexpr std::array<_Float, 4> transform(_Float x, _Float y, _Float z, _Float w)
 		{
 			_Float s2 = (x + z) * _Float(-0.28522513987434876941) + (y + w) * _Float(0.83897065470611435718);
 			_Float t2 = (y + w) * _Float(0.21939749883706435719) + (x + z) * _Float(-0.48214856493302476942);
@@ -705,14 +1360,14 @@ namespace _detail
 			_Float zs = z + s2;
 			_Float ws = w + t2;
 
-			return _detail::noise_impl<4, _Float, _Int>::eval(grads, perm, xs, ys, zs, ws);
+			return { xs, ys, zs, ws };
 		}
 	};
 
 	template<>
 	struct noise_mode_impl<4, Mode, Mode::XYZBeforeW_4D>
 	{
-		template<typename _Float, typename _Int>
+		template<typename _Float, typename _Int, typename _RadiusSq>
 		static constexpr _Float eval(
 		      const std::array<grad<4, _Float>, PSIZE>& grads,
 		      const std::array<uint16_t, PSIZE>& perm,
@@ -720,6 +1375,13 @@ namespace _detail
 		      _Float y,
 		      _Float z,
 		      _Float w)
+		{
+			std::array<_Float, 4> t = transform(x, y, z, w);
+			return _detail::noise_impl<4, _Float, _Int, _RadiusSq>::eval(grads, perm, t[0], t[1], t[2], t[3]);
+		}
+
+		template<typename _Float>
+		static constexpr std::array<_Float, 4> transform(_Float x, _Float y, _Float z, _Float w)
 		{
 			_Float xyz = x + y + z;
 			_Float ww = w * _Float(1.118033988749894);
@@ -729,7 +1391,7 @@ namespace _detail
 			_Float zs = z + s2;
 			_Float ws = _Float(-0.5) * xyz + ww;
 
-			return _detail::noise_impl<4, _Float, _Int>::eval(grads, perm, xs, ys, zs, ws);
+			return { xs, ys, zs, ws };
 		}
 	};
 
@@ -1201,66 +1863,137 @@ namespace _detail
 		// clang-format on
 	};
 
-	template<size_t _N, typename _Float, typename _Int>
-	struct pregen_lattice_list_row_initializer
+	// The 4D lattice points stored back to back, with each row's start and length. Rows hold 12 to 20 points, so
+	// this is about half the size of 256 rows padded to 20; offsets are int8, next to the precomputed dx..dw.
+	struct lattice_row_4d
 	{
-		typedef lattice_point<4, _Float, _Int> lattice_point_t;
+		uint16_t start;
+		uint8_t count;
+	};
 
-		typedef std::pair<uint8_t, std::array<lattice_point_t, 20>> lattice_lookup_row_t;
+	template<typename _Float>
+	struct lattice_point_4d
+	{
+		int8_t xsv, ysv, zsv, wsv;
+		_Float dx, dy, dz, dw;
+	};
 
-		template<typename... _F>
-		static constexpr auto init(_F... values)
+	constexpr size_t lattice_size_4d()
+	{
+		size_t size = 0;
+		for (const auto& row : pregen_lattice_list_initializer_lookup::table)
 		{
-			if constexpr (sizeof...(values) >= 20)
-			{
-				return lattice_lookup_row_t{ pregen_lattice_list_initializer_lookup::table[_N].first,
-					                         std::array<lattice_point_t, 20>{ values... } };
-			}
-			else if constexpr (sizeof...(values) < pregen_lattice_list_initializer_lookup::table[_N].first)
-			{
-				// TODO: calculate the lattice point position
-				uint8_t idx = pregen_lattice_list_initializer_lookup::table[_N].second[sizeof...(values)];
-				_Int cx = ((idx >> 0) & 3) - 1;
-				_Int cy = ((idx >> 2) & 3) - 1;
-				_Int cz = ((idx >> 4) & 3) - 1;
-				_Int cw = ((idx >> 6) & 3) - 1;
-				return pregen_lattice_list_row_initializer<_N, _Float, _Int>::init(
-				      values...,
-				      lattice_point_t{ cx, cy, cz, cw });
-			}
-			else
+			size += row.first;
+		}
+		return size;
+	}
+
+	constexpr std::array<lattice_row_4d, 256> lattice_rows_4d()
+	{
+		std::array<lattice_row_4d, 256> rows{};
+		uint16_t start = 0;
+		for (size_t i = 0; i < 256; ++i)
+		{
+			rows[i] = { start, pregen_lattice_list_initializer_lookup::table[i].first };
+			start += rows[i].count;
+		}
+		return rows;
+	}
+
+	template<typename _Float>
+	constexpr std::array<lattice_point_4d<_Float>, lattice_size_4d()> lattice_points_4d()
+	{
+		std::array<lattice_point_4d<_Float>, lattice_size_4d()> points{};
+		size_t n = 0;
+		for (const auto& row : pregen_lattice_list_initializer_lookup::table)
+		{
+			for (size_t i = 0; i < row.first; ++i, ++n)
 			{
-				return pregen_lattice_list_row_initializer<_N, _Float, _Int>::init(values..., lattice_point_t{});
+				lattice_point<4, _Float, int32_t> c(((row.second[i] >> 0) & 3) - 1, ((row.second[i] >> 2) & 3) - 1,
+				                                     ((row.second[i] >> 4) & 3) - 1, ((row.second[i] >> 6) & 3) - 1);
+				points[n] = { int8_t(c.xsv), int8_t(c.ysv), int8_t(c.zsv), int8_t(c.wsv), c.dx, c.dy, c.dz, c.dw };
 			}
 		}
+		return points;
+	}
+
+	template<typename _Float>
+	struct pregen_lattice_4d
+	{
+		static constexpr std::array<lattice_row_4d, 256> rows{ lattice_rows_4d() };
+		static constexpr std::array<lattice_point_4d<_Float>, lattice_size_4d()> points{ lattice_points_4d<_Float>() };
 	};
 
-	template<size_t _N, typename _Float, typename _Int>
-	struct pregen_lattice_list_initializer<_N, 4, _Float, _Int>
+	// The rows pruned of the points out of reach of their region, the box of side 1/4 that the index bits pick.
+	template<typename _Float, typename _Int, typename _RadiusSq>
+	struct pruned_lattice<4, _Float, _Int, _RadiusSq>
 	{
-		typedef lattice_point<4, _Float, _Int> lattice_point_t;
+		static constexpr bool reaches(size_t index, const lattice_point_4d<_Float>& c)
+		{
+			std::array<double, 4> lo{}, hi{};
+			for (uint32_t k = 0; k < 4; ++k)
+			{
+				lo[k] = ((index >> (2 * k)) & 3) * 0.25;
+				hi[k] = lo[k] + 0.25;
+			}
+			std::array<double, 4> offset{ double(c.xsv), double(c.ysv), double(c.zsv), double(c.wsv) };
+			return kernel_traits<4, _RadiusSq>::reaches(lo, hi, offset);
+		}
 
-		template<typename... _F>
-		static constexpr auto init(_F... values)
+		static constexpr size_t size()
 		{
-			if constexpr (_N >= 256)
+			size_t size = 0;
+			for (size_t index = 0; index < 256; ++index)
 			{
-				return std::array<pregen_lattice_list_row_initializer<_N, _Float, _Int>::lattice_lookup_row_t, 256>{
-					values...
-				};
+				const lattice_row_4d& row = pregen_lattice_4d<_Float>::rows[index];
+				for (size_t i = row.start; i < size_t(row.start) + row.count; ++i)
+				{
+					size += reaches(index, pregen_lattice_4d<_Float>::points[i]);
+				}
 			}
-			else
+			return size;
+		}
+
+		struct table_t
+		{
+			std::array<lattice_row_4d, 256> rows;
+			std::array<lattice_point_4d<_Float>, size()> points;
+		};
+
+		static constexpr table_t init()
+		{
+			table_t table{};
+			uint16_t start = 0;
+			for (size_t index = 0; index < 256; ++index)
 			{
-				return pregen_lattice_list_initializer<_N + 1, 4, _Float, _Int>::init(
-				      values...,
-				      pregen_lattice_list_row_initializer<_N, _Float, _Int>::init());
+				const lattice_row_4d& row = pregen_lattice_4d<_Float>::rows[index];
+				table.rows[index] = { start, 0 };
+				for (size_t i = row.start; i < size_t(row.start) + row.count; ++i)
+				{
+					if (reaches(index, pregen_lattice_4d<_Float>::points[i]))
+					{
+						table.points[start++] = pregen_lattice_4d<_Float>::points[i];
+						table.rows[index].count += 1;
+					}
+				}
 			}
+			return table;
 		}
+
+		static constexpr std::array<lattice_row_4d, 256> rows{ init().rows };
+		static constexpr std::array<lattice_point_4d<_Float>, size()> points{ init().points };
 	};
 
-	template<typename _Float, typename _Int>
-	struct noise_impl<4, _Float, _Int>
+	template<typename _Float, typename _Int, typename _RadiusSq>
+	struct noise_impl<4, _Float, _Int, _RadiusSq>
 	{
+		typedef kernel_traits<4, _RadiusSq> kernel_t;
+		typedef std::conditional_t<
+		      kernel_t::Pruned,
+		      pruned_lattice<4, _Float, _Int, _RadiusSq>,
+		      pregen_lattice_4d<_Float>>
+		      lattice_t;
+
 		static constexpr _Float eval(
 		      const std::array<grad<4, _Float>, PSIZE>& grads,
 		      const std::array<uint16_t, PSIZE>& perm,
@@ -1268,8 +2001,29 @@ namespace _detail
 		      _Float ys,
 		      _Float zs,
 		      _Float ws)
+		{
+			return eval_with(
+			      [&](const lattice_point_4d<_Float>& c, _Int xsb, _Int ysb, _Int zsb, _Int wsb)
+			            -> const grad<4, _Float>& {
+				      _Int pxm = (xsb + c.xsv) & PMASK;
+				      _Int pym = (ysb + c.ysv) & PMASK;
+				      _Int pzm = (zsb + c.zsv) & PMASK;
+				      _Int pwm = (wsb + c.wsv) & PMASK;
+				      return grads[perm[perm[perm[pxm] ^ pym] ^ pzm] ^ pwm];
+			      },
+			      xs,
+			      ys,
+			      zs,
+			      ws);
+		}
+
+		// Evaluates with gradient(c, xsb, ysb, zsb, wsb) supplying the gradient of lattice point c of the cell at
+		// (xsb, ysb, zsb, wsb).
+		template<typename _Gradient>
+		static constexpr _Float eval_with(const _Gradient& gradient, _Float xs, _Float ys, _Float zs, _Float ws)
 		{
 			_Float value = 0;
+			OSN_COUNT(evaluations4D);
 
 			// Get base points and offsets
 			_Int xsb = fastFloor<_Float, _Int>(xs);
@@ -1290,24 +2044,23 @@ namespace _detail
 			             | ((fastFloor<_Float, _Int>(zs * 4) & 3) << 4) | ((fastFloor<_Float, _Int>(ws * 4) & 3) << 6);
 
 			// Point contributions
-			for (size_t i = 0; i < pregen_lattice<4, _Float, _Int>::points[index].first; i += 1)
+			const lattice_row_4d& row = lattice_t::rows[index];
+			OSN_COUNT(rowLength[row.count]);
+			for (size_t i = row.start; i < size_t(row.start) + row.count; i += 1)
 			{
-				lattice_point<4, _Float, _Int> c = pregen_lattice<4, _Float, _Int>::points[index].second[i];
+				const lattice_point_4d<_Float>& c = lattice_t::points[i];
+				OSN_COUNT(candidates4D);
 
 				_Float dx = xi + c.dx;
 				_Float dy = yi + c.dy;
 				_Float dz = zi + c.dz;
 				_Float dw = wi + c.dw;
 
-				_Float attn = _Float(0.8) - dx * dx - dy * dy - dz * dz - dw * dw;
+				_Float attn = _Float(_RadiusSq::num) / _Float(_RadiusSq::den) - dx * dx - dy * dy - dz * dz - dw * dw;
 				if (attn > 0)
 				{
-					_Int pxm = (xsb + c.xsv) & PMASK;
-					_Int pym = (ysb + c.ysv) & PMASK;
-					_Int pzm = (zsb + c.zsv) & PMASK;
-					_Int pwm = (wsb + c.wsv) & PMASK;
-
-					grad<4, _Float> grad = grads[perm[perm[perm[pxm] ^ pym] ^ pzm] ^ pwm];
+					OSN_COUNT(contributions4D);
+					const grad<4, _Float>& grad = gradient(c, xsb, ysb, zsb, wsb);
 					_Float extrapolation = grad.v[0] * dx + grad.v[1] * dy + grad.v[2] * dz + grad.v[3] * dw;
 
 					attn *= attn;
@@ -1320,6 +2073,583 @@ namespace _detail
 	};
 
 
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Seeding
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Reciprocals ceil(2^64 / n) for the shuffle's divisors n <= PSIZE. With them, x % n is two multiplications for
+	// any x < 2^53 (Lemire, Kaser and Kurz, "Faster remainder by direct computation").
+	constexpr std::array<uint64_t, PSIZE + 1> shuffle_reciprocals()
+	{
+		std::array<uint64_t, PSIZE + 1> reciprocals{};
+		for (uint64_t n = 1; n <= uint64_t(PSIZE); ++n)
+		{
+			reciprocals[n] = ~uint64_t(0) / n + 1;
+		}
+		return reciprocals;
+	}
+
+	struct pregen_shuffle_reciprocals
+	{
+		static constexpr std::array<uint64_t, PSIZE + 1> values{ shuffle_reciprocals() };
+	};
+
+	// The seed's permutation is a Fisher-Yates shuffle drawing (seed + 31) % (i + 1) from an LCG, with the remainder
+	// taken in the seed's own type: unsigned wrap-around for unsigned seeds, the non-negative remainder for signed ones.
+	template<typename _SeedT>
+	struct seed_shuffle
+	{
+		static constexpr uint64_t reduce(uint64_t x, uint64_t n)
+		{
+			uint64_t low = pregen_shuffle_reciprocals::values[n] * x;
+#if defined(__SIZEOF_INT128__)
+			return uint64_t((unsigned __int128)low * n >> 64);
+#else
+			return ((low >> 32) * n + (((low & 0xFFFFFFFF) * n) >> 32)) >> 32;
+#endif
+		}
+
+		// x % n for any 64-bit x, reducing the upper half first so that both steps stay below 2^53.
+		static constexpr uint32_t remainder(uint64_t x, uint64_t n)
+		{
+			return uint32_t(reduce((reduce(x >> 32, n) << 32) | (x & 0xFFFFFFFF), n));
+		}
+
+		template<typename _T>
+		static constexpr uint32_t remainder_of(_T x, uint64_t n)
+		{
+			if constexpr (std::is_signed<_T>::value)
+			{
+				if (x < 0)
+				{
+					return uint32_t(n - 1 - remainder(~uint64_t(int64_t(x)), n));
+				}
+			}
+			return remainder(uint64_t(x), n);
+		}
+
+		// Fills perm and the gradients it selects, in one pass.
+		template<uint32_t _Dimensions, typename _Float>
+		static constexpr void shuffle(
+		      std::array<uint16_t, PSIZE>& perm,
+		      std::array<grad<_Dimensions, _Float>, PSIZE>& permGrad,
+		      _SeedT seed)
+		{
+			std::array<uint16_t, PSIZE> source{};
+			for (size_t i = 0; i < size_t(PSIZE); ++i)
+			{
+				source[i] = uint16_t(i);
+			}
+			for (int32_t i = PSIZE - 1; i >= 0; i -= 1)
+			{
+				seed = seed * 6364136223846793005L + 1442695040888963407L;
+				uint32_t r = remainder_of(seed + 31, uint64_t(i) + 1);
+				perm[i] = source[r];
+				permGrad[i] = pregen_gradients<_Dimensions, _Float>::grads[perm[i]];
+				source[r] = source[i];
+			}
+		}
+	};
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Grid generation
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	template<uint32_t _Dimensions, typename _ModeImpl, typename _Float, typename _Int, typename _RadiusSq>
+	struct grid_impl
+	{
+		typedef std::array<_Float, _Dimensions> point_t;
+		typedef noise_impl<_Dimensions, _Float, _Int, _RadiusSq> noise_t;
+
+		static constexpr point_t transform(const point_t& p)
+		{
+			return std::apply([](auto... v) { return _ModeImpl::transform(v...); }, p);
+		}
+
+		// Calls fn(n, p) for every sample of the grid, x varying fastest, where n is the sample's
+		// position in the output and p its coordinates after the orientation transform.
+		template<typename _Fn>
+		static void for_each(
+		      const std::array<size_t, _Dimensions>& size,
+		      const point_t& origin,
+		      _Float step,
+		      _Fn&& fn)
+		{
+			// Every orientation is linear, so a sample is its row origin plus a multiple of the transformed x step.
+			point_t base = transform(origin);
+			std::array<point_t, _Dimensions> axes;
+			for (uint32_t k = 0; k < _Dimensions; ++k)
+			{
+				point_t e{};
+				e[k] = step;
+				axes[k] = transform(e);
+			}
+
+			size_t rows = 1;
+			for (uint32_t k = 1; k < _Dimensions; ++k)
+			{
+				rows *= size[k];
+			}
+
+			std::array<size_t, _Dimensions> idx{};
+			size_t n = 0;
+			for (size_t row = 0; row < rows; ++row)
+			{
+				point_t rowOrigin = base;
+				for (uint32_t k = 1; k < _Dimensions; ++k)
+				{
+					for (uint32_t a = 0; a < _Dimensions; ++a)
+					{
+						rowOrigin[a] += _Float(idx[k]) * axes[k][a];
+					}
+				}
+
+				for (size_t i = 0; i < size[0]; ++i)
+				{
+					point_t p;
+					for (uint32_t a = 0; a < _Dimensions; ++a)
+					{
+						p[a] = rowOrigin[a] + _Float(i) * axes[0][a];
+					}
+					fn(n++, p);
+				}
+
+				for (uint32_t k = 1; k < _Dimensions && ++idx[k] == size[k]; ++k)
+				{
+					idx[k] = 0;
+				}
+			}
+		}
+
+		static void generate(
+		      const std::array<grad<_Dimensions, _Float>, PSIZE>& grads,
+		      const std::array<uint16_t, PSIZE>& perm,
+		      _Float* out,
+		      const std::array<size_t, _Dimensions>& size,
+		      const point_t& origin,
+		      _Float step)
+		{
+			for_each(size, origin, step, [&](size_t n, const point_t& p) {
+				out[n] = std::apply(
+				      [&](auto... v) { return noise_t::eval(grads, perm, v...); },
+				      p);
+			});
+		}
+
+		template<typename _Out>
+		static void generate_quantized(
+		      const std::array<grad<_Dimensions, _Float>, PSIZE>& grads,
+		      const std::array<uint16_t, PSIZE>& perm,
+		      _Out* out,
+		      const std::array<size_t, _Dimensions>& size,
+		      const point_t& origin,
+		      _Float step,
+		      _Float scale,
+		      _Float bias)
+		{
+			for_each(size, origin, step, [&](size_t n, const point_t& p) {
+				_Float v = std::apply(
+				      [&](auto... v) { return noise_t::eval(grads, perm, v...); },
+				      p);
+				out[n] = quantizer<_Out>::store(v * scale + bias);
+			});
+		}
+	};
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Output formats
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	template<typename _Out>
+	struct quantizer
+	{
+		static_assert(std::is_same<_Out, uint8_t>::value || std::is_same<_Out, uint16_t>::value,
+		              "Quantized output is uint8_t, uint16_t, Half or BFloat16");
+
+		// NaN passes through min and max unchanged, and converting it to an integer is undefined, so it stores as 0.
+		template<typename _Float>
+		static _Out store(_Float v)
+		{
+			constexpr _Float Max = _Float(std::numeric_limits<_Out>::max());
+			return v == v ? _Out(std::min(std::max(v, _Float(0)), Max) + _Float(0.5)) : _Out(0);
+		}
+	};
+
+	template<>
+	struct quantizer<Half>
+	{
+		template<typename _Float>
+		static Half store(_Float v)
+		{
+			return Half(float(v));
+		}
+	};
+
+	template<>
+	struct quantizer<BFloat16>
+	{
+		template<typename _Float>
+		static BFloat16 store(_Float v)
+		{
+			return BFloat16(float(v));
+		}
+	};
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Range bounds
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	template<uint32_t _Dimensions>
+	struct bounds_traits;
+
+	template<>
+	struct bounds_traits<2>
+	{
+		static constexpr double Unskew = -0.211324865405187;
+		static constexpr double Reach = 1.4143; // Kernel radius stretched by the skew along the main diagonal.
+		static constexpr double Curvature = 1.1410; // 4.7162 r^7, the largest Hessian norm bound of a unit kernel.
+		static constexpr uint32_t Lattices = 1;
+	};
+
+	template<>
+	struct bounds_traits<3>
+	{
+		// Two cubic lattices, the second offset by half a cell and hashed 1024 cells away.
+		static constexpr double Unskew = 0;
+		static constexpr double Reach = 0.8661;
+		static constexpr double Curvature = 1.7232;
+		static constexpr uint32_t Lattices = 2;
+	};
+
+	template<>
+	struct bounds_traits<4>
+	{
+		static constexpr double Unskew = -0.138196601125011;
+		static constexpr double Reach = 2.0001;
+		static constexpr double Curvature = 2.1600;
+		static constexpr uint32_t Lattices = 1;
+	};
+
+	// Conservative bounds of the noise over an axis-aligned box.
+	// Every lattice point whose kernel can reach the box contributes an interval from the nearest and farthest
+	// distances to the box and from a Taylor expansion around its center. The whole sum is also expanded to third order,
+	// which is much tighter for small boxes since the slopes of neighbouring kernels partly cancel.
+	template<uint32_t _Dimensions, typename _ModeImpl, typename _Float, typename _RadiusSq>
+	struct bounds_impl
+	{
+		typedef bounds_traits<_Dimensions> traits;
+		typedef kernel_traits<_Dimensions, _RadiusSq> radius_t;
+		typedef std::array<double, _Dimensions> point_t;
+
+		// The traits hold for the default radius; a smaller kernel's Hessian bound shrinks as r^7, and its reach is
+		// left as the default's, which only visits a few more lattice points.
+		static constexpr double R = radius_t::RadiusSq;
+		static constexpr double Curvature =
+		      traits::Curvature
+		      / (radius_t::Shrink * radius_t::Shrink * radius_t::Shrink * sqrt_constexpr(radius_t::Shrink));
+
+		// The box in lattice space and, since every orientation is linear, its extents in unskewed space.
+		struct box_t
+		{
+			point_t sMin, sMax, uMin, uMax, uCenter, halfWidth;
+			double reach, reachSq;
+		};
+
+		// Offsets from one lattice point to the box. far is clamped to the kernel radius.
+		struct kernel_t
+		{
+			point_t dMin, dMax, dCenter;
+			double nearSq, far, centerSq;
+		};
+
+		static point_t unskew(const point_t& s)
+		{
+			double sum = 0;
+			for (double v : s)
+			{
+				sum += v;
+			}
+			point_t u;
+			for (uint32_t k = 0; k < _Dimensions; ++k)
+			{
+				u[k] = s[k] + sum * traits::Unskew;
+			}
+			return u;
+		}
+
+		// Maximum over s in [s0, s1] of a function of the squared distance with a single peak at sPeak.
+		template<typename _Fn>
+		static double peak(_Fn fn, double sPeak, double s0, double s1)
+		{
+			return sPeak < s0 ? fn(s0) : sPeak > s1 ? fn(s1) : fn(sPeak);
+		}
+
+		static box_t box(const std::array<_Float, _Dimensions>& boxMin, const std::array<_Float, _Dimensions>& boxMax)
+		{
+			box_t b;
+			std::array<point_t, (1u << _Dimensions)> corners;
+			b.sMin.fill(1e300);
+			b.sMax.fill(-1e300);
+			b.uMin = b.sMin;
+			b.uMax = b.sMax;
+			for (uint32_t corner = 0; corner < corners.size(); ++corner)
+			{
+				point_t p;
+				for (uint32_t k = 0; k < _Dimensions; ++k)
+				{
+					p[k] = double((corner >> k) & 1 ? boxMax[k] : boxMin[k]);
+				}
+				point_t s = std::apply([](auto... v) { return _ModeImpl::transform(v...); }, p);
+				corners[corner] = unskew(s);
+				for (uint32_t k = 0; k < _Dimensions; ++k)
+				{
+					b.sMin[k] = std::min(b.sMin[k], s[k]);
+					b.sMax[k] = std::max(b.sMax[k], s[k]);
+					b.uMin[k] = std::min(b.uMin[k], corners[corner][k]);
+					b.uMax[k] = std::max(b.uMax[k], corners[corner][k]);
+				}
+			}
+
+			// The image of the box is centrally symmetric, so its center is that of its bounding box.
+			for (uint32_t k = 0; k < _Dimensions; ++k)
+			{
+				b.uCenter[k] = 0.5 * (b.uMin[k] + b.uMax[k]);
+				b.halfWidth[k] = 0.5 * (b.uMax[k] - b.uMin[k]);
+			}
+			b.reachSq = 0;
+			for (const point_t& u : corners)
+			{
+				double distSq = 0;
+				for (uint32_t k = 0; k < _Dimensions; ++k)
+				{
+					distSq += (u[k] - b.uCenter[k]) * (u[k] - b.uCenter[k]);
+				}
+				b.reachSq = std::max(b.reachSq, distSq);
+			}
+			b.reach = std::sqrt(b.reachSq);
+			return b;
+		}
+
+		// Calls fn(gradient, kernel) for every lattice point whose kernel reaches the box.
+		template<typename _Fn>
+		static void for_each_kernel(
+		      const std::array<grad<_Dimensions, _Float>, PSIZE>& grads,
+		      const std::array<uint16_t, PSIZE>& perm,
+		      const box_t& b,
+		      _Fn fn)
+		{
+			std::array<int64_t, _Dimensions> lo, hi, idx;
+			for (uint32_t lattice = 0; lattice < traits::Lattices; ++lattice)
+			{
+				for (uint32_t k = 0; k < _Dimensions; ++k)
+				{
+					lo[k] = int64_t(std::floor(b.sMin[k] + lattice * 0.5 - traits::Reach));
+					hi[k] = int64_t(std::ceil(b.sMax[k] + lattice * 0.5 + traits::Reach));
+				}
+				idx = lo;
+				for (;;)
+				{
+					point_t l;
+					for (uint32_t k = 0; k < _Dimensions; ++k)
+					{
+						l[k] = double(idx[k]) - lattice * 0.5;
+					}
+					point_t ul = unskew(l);
+
+					kernel_t c;
+					double farSq = 0;
+					c.nearSq = 0;
+					c.centerSq = 0;
+					for (uint32_t k = 0; k < _Dimensions; ++k)
+					{
+						c.dMin[k] = b.uMin[k] - ul[k];
+						c.dMax[k] = b.uMax[k] - ul[k];
+						c.dCenter[k] = b.uCenter[k] - ul[k];
+						double n = c.dMin[k] > 0 ? c.dMin[k] : c.dMax[k] < 0 ? -c.dMax[k] : 0;
+						double f = std::max(std::abs(c.dMin[k]), std::abs(c.dMax[k]));
+						c.nearSq += n * n;
+						farSq += f * f;
+						c.centerSq += c.dCenter[k] * c.dCenter[k];
+					}
+					c.far = std::min(farSq, R);
+
+					if (c.nearSq < R)
+					{
+						int64_t h = (idx[0] + lattice * (PSIZE / 2)) & PMASK;
+						for (uint32_t k = 1; k < _Dimensions; ++k)
+						{
+							h = perm[h] ^ ((idx[k] + lattice * (PSIZE / 2)) & PMASK);
+						}
+						fn(grads[h], c);
+					}
+
+					uint32_t k = 0;
+					for (; k < _Dimensions && ++idx[k] > hi[k]; ++k)
+					{
+						idx[k] = lo[k];
+					}
+					if (k == _Dimensions)
+					{
+						break;
+					}
+				}
+			}
+		}
+
+		// Bound on the Hessian norm of a kernel with a unit gradient, at squared distances within [nearSq, far].
+		// In the plane of d and g the Hessian has entries P cos, -Q sin and -Q cos, so its norm is at most
+		// sqrt(max(P^2, Q^2) + Q^2) with P = 24 a^2 |d| (3 |d|^2 - r^2) and Q = 8 a^3 |d|.
+		static double kernel_curvature(double nearSq, double far)
+		{
+			double aNear = R - nearSq, dFar = std::sqrt(far);
+			double p = 24 * aNear * aNear * dFar * std::max(std::abs(3 * nearSq - R), std::abs(3 * far - R));
+			double q = 8 * aNear * aNear * aNear * dFar;
+			return std::min(Curvature, std::sqrt(std::max(p * p, q * q) + q * q));
+		}
+
+		// Bound on the third derivative along any unit direction of a kernel with a unit gradient. With b = d.v it is
+		// 48 a b (3 a - 4 b^2) (g.d) + 24 a^2 (6 b^2 - a) (g.v), with |b| <= |d|.
+		static double kernel_third(double nearSq, double far)
+		{
+			double aNear = R - nearSq, aFar = R - far;
+			return 48 * aNear * far * std::max(3 * aNear, 4 * far - 3 * aFar)
+			      + 24 * aNear * aNear * std::max(aNear, 6 * far - aFar);
+		}
+
+		// Adds the Hessian of a kernel at the center of the box.
+		static void add_center_hessian(
+		      std::array<point_t, _Dimensions>& hessian,
+		      const grad<_Dimensions, _Float>& g,
+		      const kernel_t& c)
+		{
+			double ac = std::max(R - c.centerSq, 0.0), ec = 0;
+			for (uint32_t k = 0; k < _Dimensions; ++k)
+			{
+				ec += double(g.v[k]) * c.dCenter[k];
+			}
+			for (uint32_t k = 0; k < _Dimensions; ++k)
+			{
+				for (uint32_t m = 0; m < _Dimensions; ++m)
+				{
+					hessian[k][m] += ac * ac
+					      * (48 * ec * c.dCenter[k] * c.dCenter[m]
+					         - 8 * ac * (c.dCenter[k] * double(g.v[m]) + double(g.v[k]) * c.dCenter[m] + (k == m ? ec : 0)));
+				}
+			}
+		}
+
+		static std::pair<double, double> range(
+		      const std::array<grad<_Dimensions, _Float>, PSIZE>& grads,
+		      const std::array<uint16_t, PSIZE>& perm,
+		      const std::array<_Float, _Dimensions>& boxMin,
+		      const std::array<_Float, _Dimensions>& boxMax)
+		{
+			box_t b = box(boxMin, boxMax);
+			double valueMin = 0, valueMax = 0, totalCenter = 0, totalThird = 0;
+			point_t totalGradient{};
+			std::array<point_t, _Dimensions> totalHessian{};
+
+			for_each_kernel(grads, perm, b, [&](const grad<_Dimensions, _Float>& g, const kernel_t& c) {
+				// Each contribution is a^4 (g.d) with a = r^2 - |d|^2.
+				double aNear = R - c.nearSq, aFar = R - c.far;
+				double a0 = aFar * aFar * aFar * aFar, a1 = aNear * aNear * aNear * aNear;
+
+				double e0 = 0, e1 = 0, ec = 0, gSq = 0;
+				for (uint32_t k = 0; k < _Dimensions; ++k)
+				{
+					double gk = double(g.v[k]);
+					e0 += gk * (gk < 0 ? c.dMax[k] : c.dMin[k]);
+					e1 += gk * (gk < 0 ? c.dMin[k] : c.dMax[k]);
+					ec += gk * c.dCenter[k];
+					gSq += gk * gk;
+				}
+				double gLen = std::sqrt(gSq);
+
+				// Magnitude: |a^4 (g.d)| <= |g| a^4 |d|, keeping the sign where the extrapolation has one.
+				double magnitude = gLen
+				      * peak([](double s) { return (R - s) * (R - s) * (R - s) * (R - s) * std::sqrt(s); }, R / 9, c.nearSq, c.far);
+				double kernelMin = e0 < 0 ? std::max(-magnitude, a1 * e0) : a0 * e0;
+				double kernelMax = e1 > 0 ? std::min(magnitude, a1 * e1) : a0 * e1;
+
+				// Small boxes are bounded tighter around the value at their center, to first order by the slope
+				// |a^4 g - 8 a^3 (g.d) d| <= |g| a^3 (a + 8 |d|^2), and to second order by the curvature.
+				double ac = std::max(R - c.centerSq, 0.0);
+				double center = ac * ac * ac * ac * ec;
+				double slope = gLen
+				      * peak([](double s) { return (R - s) * (R - s) * (R - s) * (R + 7 * s); }, R / 7, c.nearSq, c.far);
+				double curvature = gLen * kernel_curvature(c.nearSq, c.far);
+				double linear = 0;
+				for (uint32_t k = 0; k < _Dimensions; ++k)
+				{
+					double gradient = ac * ac * ac * (ac * double(g.v[k]) - 8 * ec * c.dCenter[k]);
+					linear += std::abs(gradient) * b.halfWidth[k];
+					totalGradient[k] += gradient;
+				}
+				double spread = std::min(slope * b.reach, linear + 0.5 * curvature * b.reachSq);
+
+				valueMin += std::max(kernelMin, center - spread);
+				valueMax += std::min(kernelMax, center + spread);
+
+				add_center_hessian(totalHessian, g, c);
+				totalCenter += center;
+				totalThird += gLen * kernel_third(c.nearSq, c.far);
+			});
+
+			double spread = totalThird * b.reachSq * b.reach / 6;
+			for (uint32_t k = 0; k < _Dimensions; ++k)
+			{
+				spread += std::abs(totalGradient[k]) * b.halfWidth[k];
+				for (uint32_t m = 0; m < _Dimensions; ++m)
+				{
+					spread += 0.5 * std::abs(totalHessian[k][m]) * b.halfWidth[k] * b.halfWidth[m];
+				}
+			}
+			valueMin = std::max(valueMin, totalCenter - spread);
+			valueMax = std::min(valueMax, totalCenter + spread);
+
+			// Leave room for the rounding of the evaluator itself.
+			double slack = 1e-5 * (1 + std::max(std::abs(valueMin), std::abs(valueMax)));
+			return { valueMin - slack, valueMax + slack };
+		}
+
+		// Bound on the norm of the Hessian of the noise over the box, from the kernels one by one or from the Hessian
+		// at the center and the third derivatives. Every orientation is a rotation of the unskewed space, so the bound
+		// holds in input coordinates as well.
+		static double curvature(
+		      const std::array<grad<_Dimensions, _Float>, PSIZE>& grads,
+		      const std::array<uint16_t, PSIZE>& perm,
+		      const std::array<_Float, _Dimensions>& boxMin,
+		      const std::array<_Float, _Dimensions>& boxMax)
+		{
+			box_t b = box(boxMin, boxMax);
+			double total = 0, totalThird = 0;
+			std::array<point_t, _Dimensions> totalHessian{};
+			for_each_kernel(grads, perm, b, [&](const grad<_Dimensions, _Float>& g, const kernel_t& c) {
+				double gSq = 0;
+				for (uint32_t k = 0; k < _Dimensions; ++k)
+				{
+					gSq += double(g.v[k]) * double(g.v[k]);
+				}
+				total += std::sqrt(gSq) * kernel_curvature(c.nearSq, c.far);
+				totalThird += std::sqrt(gSq) * kernel_third(c.nearSq, c.far);
+				add_center_hessian(totalHessian, g, c);
+			});
+
+			double frobeniusSq = 0;
+			for (const point_t& row : totalHessian)
+			{
+				for (double v : row)
+				{
+					frobeniusSq += v * v;
+				}
+			}
+			return std::min(total, std::sqrt(frobeniusSq) + totalThird * b.reach);
+		}
+	};
+
 } // namespace _detail
 
 } // namespace osn
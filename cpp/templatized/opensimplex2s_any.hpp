@@ -0,0 +1,232 @@
+#pragma once
+
+#include "opensimplex2s.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+
+namespace osn
+{
+
+constexpr uint32_t mode_dimensions(Mode mode)
+{
+	switch (mode)
+	{
+	case Mode::Standard_2D:
+	case Mode::XBeforeY_2D:
+		return 2;
+	case Mode::Classic_3D:
+	case Mode::XYBeforeZ_3D:
+	case Mode::XZBeforeY_3D:
+		return 3;
+	default:
+		return 4;
+	}
+}
+
+namespace _detail
+{
+	// A seed's tables for one dimension. Every orientation of that dimension reads the same ones.
+	template<uint32_t _Dimensions, typename _Float>
+	struct any_tables
+	{
+		std::array<uint16_t, PSIZE> perm;
+		std::array<grad<_Dimensions, _Float>, PSIZE> permGrad;
+	};
+
+	// The entry points of one mode, called with that mode's dimension's any_tables.
+	template<typename _Float>
+	struct any_mode_ops
+	{
+		void (*generate)(const void* tables, _Float* out, const size_t* size, const _Float* origin, _Float step);
+		void (*evaluate)(const void* tables, const _Float* points, size_t count, _Float* out);
+	};
+
+	template<uint32_t _Dimensions, Mode _Mode, typename _Float, typename _Int>
+	struct any_mode_impl
+	{
+		typedef any_tables<_Dimensions, _Float> tables_t;
+		typedef noise_mode_impl<_Dimensions, Mode, _Mode> mode_impl_t;
+		typedef typename kernel_radius<_Dimensions>::type radius_t;
+		typedef grid_impl<_Dimensions, mode_impl_t, _Float, _Int, radius_t> grid_impl_t;
+
+		static void generate(const void* tables, _Float* out, const size_t* size, const _Float* origin, _Float step)
+		{
+			const tables_t& t = *static_cast<const tables_t*>(tables);
+			std::array<size_t, _Dimensions> s;
+			std::array<_Float, _Dimensions> o;
+			std::copy(size, size + _Dimensions, s.begin());
+			std::copy(origin, origin + _Dimensions, o.begin());
+			grid_impl_t::generate(t.permGrad, t.perm, out, s, o, step);
+		}
+
+		static void evaluate(const void* tables, const _Float* points, size_t count, _Float* out)
+		{
+			const tables_t& t = *static_cast<const tables_t*>(tables);
+			for (size_t n = 0; n < count; ++n, points += _Dimensions)
+			{
+				std::array<_Float, _Dimensions> p;
+				std::copy(points, points + _Dimensions, p.begin());
+				out[n] = std::apply(
+				      [&](auto... v) {
+					      return mode_impl_t::template eval<_Float, _Int, radius_t>(t.permGrad, t.perm, v...);
+				      },
+				      p);
+			}
+		}
+
+		static constexpr any_mode_ops<_Float> ops{ &generate, &evaluate };
+	};
+
+	template<typename _Float, typename _Int>
+	const any_mode_ops<_Float>& any_mode_lookup(Mode mode)
+	{
+		switch (mode)
+		{
+		case Mode::Standard_2D:
+			return any_mode_impl<2, Mode::Standard_2D, _Float, _Int>::ops;
+		case Mode::XBeforeY_2D:
+			return any_mode_impl<2, Mode::XBeforeY_2D, _Float, _Int>::ops;
+		case Mode::Classic_3D:
+			return any_mode_impl<3, Mode::Classic_3D, _Float, _Int>::ops;
+		case Mode::XYBeforeZ_3D:
+			return any_mode_impl<3, Mode::XYBeforeZ_3D, _Float, _Int>::ops;
+		case Mode::XZBeforeY_3D:
+			return any_mode_impl<3, Mode::XZBeforeY_3D, _Float, _Int>::ops;
+		case Mode::Classic_4D:
+			return any_mode_impl<4, Mode::Classic_4D, _Float, _Int>::ops;
+		case Mode::XYBeforeZW_4D:
+			return any_mode_impl<4, Mode::XYBeforeZW_4D, _Float, _Int>::ops;
+		case Mode::XZBeforeYW_4D:
+			return any_mode_impl<4, Mode::XZBeforeYW_4D, _Float, _Int>::ops;
+		default:
+			return any_mode_impl<4, Mode::XYZBeforeW_4D, _Float, _Int>::ops;
+		}
+	}
+
+	template<uint32_t _Dimensions, typename _Float, typename _SeedT>
+	std::shared_ptr<const void> make_any_tables(_SeedT seed)
+	{
+		std::shared_ptr<any_tables<_Dimensions, _Float>> tables = std::make_shared<any_tables<_Dimensions, _Float>>();
+		seed_shuffle<_SeedT>::shuffle(tables->perm, tables->permGrad, seed);
+		return tables;
+	}
+
+} // namespace _detail
+
+// OpenSimplex2S with its mode, and so its dimension, chosen at run time, as from a data file. The mode is resolved
+// to its kernels once, at construction, and each call is a single indirect call to a loop compiled for that mode:
+// batches cost what the templated generate() does, while single points pay the call each. Copies and with_mode()
+// of the same dimension share the seed's tables, which do not depend on the orientation.
+template<typename _Float = float, typename _Int = int32_t>
+class AnyOpenSimplex2S
+{
+	typedef std::shared_ptr<const void> (*make_tables_t)(uint32_t dimensions, const void* seed);
+
+	Mode noiseMode;
+	uint64_t seedValue;
+	uint32_t seedType;
+	// The seed as given, since its type selects the shuffle, and the function building its tables for a dimension.
+	std::shared_ptr<const void> seedBits;
+	make_tables_t makeTables;
+	std::shared_ptr<const void> tables;
+	const _detail::any_mode_ops<_Float>* ops;
+
+	template<typename _SeedT>
+	static std::shared_ptr<const void> make_tables(uint32_t dimensions, const void* seed)
+	{
+		const _SeedT& s = *static_cast<const _SeedT*>(seed);
+		switch (dimensions)
+		{
+		case 2:
+			return _detail::make_any_tables<2, _Float>(s);
+		case 3:
+			return _detail::make_any_tables<3, _Float>(s);
+		default:
+			return _detail::make_any_tables<4, _Float>(s);
+		}
+	}
+
+	template<typename _T>
+	void check(std::initializer_list<_T> values, const char* what) const
+	{
+		if (values.size() != dimensions())
+		{
+			throw std::invalid_argument(std::string(what) + " must have one entry per dimension of the mode");
+		}
+	}
+
+  public:
+	typedef _Float float_type;
+
+	// The same noise as OpenSimplex2S<mode_dimensions(mode), mode, _Float, _Int>(seed).
+	template<typename _SeedT = uint64_t>
+	AnyOpenSimplex2S(Mode mode, _SeedT seed = 0)
+	    : noiseMode(mode)
+	    , seedValue(uint64_t(seed))
+	    , seedType(seed_type_of<_SeedT>())
+	    , seedBits(std::make_shared<const _SeedT>(seed))
+	    , makeTables(&make_tables<_SeedT>)
+	    , tables(makeTables(mode_dimensions(mode), seedBits.get()))
+	    , ops(&_detail::any_mode_lookup<_Float, _Int>(mode))
+	{
+	}
+
+	// The same seed's noise in another mode, sharing this one's tables if the dimension is the same.
+	AnyOpenSimplex2S with_mode(Mode mode) const
+	{
+		AnyOpenSimplex2S other(*this);
+		other.noiseMode = mode;
+		other.ops = &_detail::any_mode_lookup<_Float, _Int>(mode);
+		if (mode_dimensions(mode) != dimensions())
+		{
+			other.tables = makeTables(mode_dimensions(mode), seedBits.get());
+		}
+		return other;
+	}
+
+	Mode mode() const { return noiseMode; }
+	uint32_t dimensions() const { return mode_dimensions(noiseMode); }
+	uint64_t seed() const { return seedValue; }
+	uint32_t seed_type() const { return seedType; }
+	bool shares_tables(const AnyOpenSimplex2S& other) const { return tables == other.tables; }
+
+	// As OpenSimplex2S::generate(), with size and origin holding one entry per dimension.
+	void generate(_Float* out, std::initializer_list<size_t> size, std::initializer_list<_Float> origin, _Float step)
+	      const
+	{
+		check(size, "size");
+		check(origin, "origin");
+		ops->generate(tables.get(), out, size.begin(), origin.begin(), step);
+	}
+
+	// out[n] = noise(points[n * dimensions()], ..., points[n * dimensions() + dimensions() - 1]) for n < count.
+	void evaluate(const _Float* points, size_t count, _Float* out) const
+	{
+		ops->evaluate(tables.get(), points, count, out);
+	}
+
+	// A single point with one coordinate per dimension. Each call is an indirect call; prefer the batches.
+	template<
+	      typename... _F,
+	      class = std::common_type<_Float, _F...>,
+	      std::enable_if_t<(sizeof...(_F) >= 2 && sizeof...(_F) <= 4)>* = nullptr>
+	_Float operator()(_F... vals) const
+	{
+		if (sizeof...(_F) != dimensions())
+		{
+			throw std::invalid_argument("A point must have one coordinate per dimension of the mode");
+		}
+		const _Float p[] = { _Float(vals)... };
+		_Float value;
+		ops->evaluate(tables.get(), p, 1, &value);
+		return value;
+	}
+};
+
+} // namespace osn
@@ -0,0 +1,264 @@
+#pragma once
+
+#include "opensimplex2s.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace osn
+{
+
+// Requests of a higher priority are always started before any of a lower one; within a level they run in order.
+enum class Priority : uint32_t
+{
+	High,
+	Normal,
+	Low
+};
+
+constexpr uint32_t PriorityLevels = 3;
+
+// Shared flag for dropping requests whose results are no longer wanted, e.g. chunks a player has moved away from.
+// Copies refer to the same flag, so one token can cancel a whole group of requests.
+class CancellationToken
+{
+	std::shared_ptr<std::atomic<bool>> flag = std::make_shared<std::atomic<bool>>(false);
+
+  public:
+	void cancel() { flag->store(true, std::memory_order_relaxed); }
+	bool cancelled() const { return flag->load(std::memory_order_relaxed); }
+};
+
+// Thrown from the future of a request that was cancelled, or still pending when its generator shut down.
+struct GenerationCancelled : std::exception
+{
+	const char* what() const noexcept override { return "noise generation cancelled"; }
+};
+
+struct AsyncGeneratorStats
+{
+	uint64_t completed = 0;
+	uint64_t cancelled = 0;
+};
+
+
+// Generates grids of noise on an internal thread pool. Each priority level has its own bounded queue: submit()
+// blocks while its level's queue is full, so a saturating low-priority producer is held back without delaying
+// high-priority requests. Cancelled requests are dropped without generating, when a worker reaches them or when
+// their queue is full.
+template<typename _Noise>
+class AsyncGenerator
+{
+  public:
+	typedef typename _Noise::float_type float_type;
+	typedef std::array<size_t, _Noise::Dimensions> size_type;
+	typedef std::array<float_type, _Noise::Dimensions> point_type;
+
+  private:
+	struct Request
+	{
+		size_type size;
+		point_type origin;
+		float_type step;
+		CancellationToken token;
+		std::promise<std::vector<float_type>> promise;
+	};
+
+	const _Noise& noise;
+	size_t capacity;
+	mutable std::mutex mutex;
+	std::condition_variable workAvailable, spaceAvailable;
+	std::array<std::deque<Request>, PriorityLevels> queues;
+	bool stopping = false;
+	std::vector<std::thread> workers;
+
+	std::atomic<uint64_t> completed{ 0 };
+	std::atomic<uint64_t> cancelled{ 0 };
+
+	void run(Request& request)
+	{
+		if (request.token.cancelled())
+		{
+			cancelled.fetch_add(1, std::memory_order_relaxed);
+			request.promise.set_exception(std::make_exception_ptr(GenerationCancelled{}));
+			return;
+		}
+
+		try
+		{
+			size_t count = 1;
+			for (size_t s : request.size)
+			{
+				count *= s;
+			}
+			std::vector<float_type> values(count);
+			noise.generate(values.data(), request.size, request.origin, request.step);
+			completed.fetch_add(1, std::memory_order_relaxed);
+			request.promise.set_value(std::move(values));
+		}
+		catch (...)
+		{
+			request.promise.set_exception(std::current_exception());
+		}
+	}
+
+	// Must be called with the mutex locked. Returns the number of requests dropped.
+	size_t drop_cancelled(std::deque<Request>& queue)
+	{
+		size_t before = queue.size();
+		for (auto it = queue.begin(); it != queue.end();)
+		{
+			if (it->token.cancelled())
+			{
+				cancelled.fetch_add(1, std::memory_order_relaxed);
+				it->promise.set_exception(std::make_exception_ptr(GenerationCancelled{}));
+				it = queue.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		return before - queue.size();
+	}
+
+	void work()
+	{
+		for (;;)
+		{
+			Request request;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				uint32_t level = PriorityLevels;
+				workAvailable.wait(lock, [&]() {
+					for (level = 0; level < PriorityLevels && queues[level].empty(); ++level)
+					{
+					}
+					return stopping || level < PriorityLevels;
+				});
+				if (level == PriorityLevels)
+				{
+					return;
+				}
+				request = std::move(queues[level].front());
+				queues[level].pop_front();
+			}
+			spaceAvailable.notify_all();
+			run(request);
+		}
+	}
+
+	template<bool _Wait>
+	std::future<std::vector<float_type>> enqueue(
+	      const size_type& size,
+	      const point_type& origin,
+	      float_type step,
+	      Priority priority,
+	      const CancellationToken& token)
+	{
+		std::deque<Request>& queue = queues[std::min(uint32_t(priority), PriorityLevels - 1)];
+		std::future<std::vector<float_type>> future;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			auto space = [&]() { return stopping || queue.size() < capacity || drop_cancelled(queue) > 0; };
+			if (_Wait)
+			{
+				spaceAvailable.wait(lock, space);
+			}
+			if (stopping || !space())
+			{
+				return future;
+			}
+			queue.push_back(Request{ size, origin, step, token, {} });
+			future = queue.back().promise.get_future();
+		}
+		workAvailable.notify_one();
+		return future;
+	}
+
+  public:
+	AsyncGenerator(const _Noise& noise, size_t threadCount = std::thread::hardware_concurrency(), size_t capacity = 256)
+	    : noise(noise)
+	    , capacity(std::max(capacity, size_t(1)))
+	{
+		threadCount = std::max(threadCount, size_t(1));
+		for (size_t t = 0; t < threadCount; ++t)
+		{
+			workers.emplace_back([this]() { work(); });
+		}
+	}
+
+	// Pending requests are cancelled; those already running finish first.
+	~AsyncGenerator()
+	{
+		std::array<std::deque<Request>, PriorityLevels> pending;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			pending.swap(queues);
+		}
+		workAvailable.notify_all();
+		spaceAvailable.notify_all();
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+		for (std::deque<Request>& queue : pending)
+		{
+			for (Request& request : queue)
+			{
+				cancelled.fetch_add(1, std::memory_order_relaxed);
+				request.promise.set_exception(std::make_exception_ptr(GenerationCancelled{}));
+			}
+		}
+	}
+
+	AsyncGenerator(const AsyncGenerator&) = delete;
+	AsyncGenerator& operator=(const AsyncGenerator&) = delete;
+
+	// Queues the grid noise.generate(out, size, origin, step) would fill, waiting while the priority's queue is full.
+	std::future<std::vector<float_type>> submit(
+	      const size_type& size,
+	      const point_type& origin,
+	      float_type step,
+	      Priority priority = Priority::Normal,
+	      const CancellationToken& token = {})
+	{
+		return enqueue<true>(size, origin, step, priority, token);
+	}
+
+	// Like submit(), but returns an invalid future instead of waiting when the priority's queue is full.
+	std::future<std::vector<float_type>> try_submit(
+	      const size_type& size,
+	      const point_type& origin,
+	      float_type step,
+	      Priority priority = Priority::Normal,
+	      const CancellationToken& token = {})
+	{
+		return enqueue<false>(size, origin, step, priority, token);
+	}
+
+	size_t pending(Priority priority) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return queues[std::min(uint32_t(priority), PriorityLevels - 1)].size();
+	}
+
+	AsyncGeneratorStats stats() const
+	{
+		AsyncGeneratorStats s;
+		s.completed = completed.load(std::memory_order_relaxed);
+		s.cancelled = cancelled.load(std::memory_order_relaxed);
+		return s;
+	}
+};
+
+} // namespace osn
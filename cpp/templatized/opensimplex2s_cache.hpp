@@ -0,0 +1,313 @@
+#pragma once
+
+#include "opensimplex2s.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace osn
+{
+
+struct ChunkKey
+{
+	uint64_t seed = 0;
+	// seed_type_of() the seed's type, which selects the noise along with its value.
+	uint32_t seedType = seed_type_of<uint64_t>();
+	Mode mode = Mode::Standard_2D;
+	uint32_t dimensions = 0;
+	std::array<int64_t, 4> chunk{};
+	double frequency = 0;
+	// Samples per axis. Chunks at one coordinate but of different sizes cover different regions.
+	uint64_t chunkSize = 0;
+	// Fractal sums of octaves, as generated by the tile service; chunks of plain noise keep the defaults.
+	uint32_t octaves = 1;
+	double lacunarity = 2;
+	double gain = 0.5;
+	// The kernel's squared radius radiusNum / radiusDen, and seed_type_of() the integer type the lattice is floored
+	// in. Both change the noise; set_kernel() fills them in.
+	int64_t radiusNum = 0;
+	int64_t radiusDen = 1;
+	uint32_t intType = seed_type_of<int32_t>();
+
+	template<typename _RadiusSq, typename _Int = int32_t>
+	void set_kernel()
+	{
+		radiusNum = int64_t(_RadiusSq::num);
+		radiusDen = int64_t(_RadiusSq::den);
+		intType = seed_type_of<_Int>();
+	}
+
+	// The default kernel of the key's dimension, as AnyOpenSimplex2S uses.
+	void set_default_kernel()
+	{
+		switch (dimensions)
+		{
+		case 2:
+			return set_kernel<typename _detail::kernel_radius<2>::type>();
+		case 3:
+			return set_kernel<typename _detail::kernel_radius<3>::type>();
+		default:
+			return set_kernel<typename _detail::kernel_radius<4>::type>();
+		}
+	}
+
+	bool operator==(const ChunkKey& o) const
+	{
+		return seed == o.seed && seedType == o.seedType && mode == o.mode && dimensions == o.dimensions
+		       && chunk == o.chunk && frequency == o.frequency && chunkSize == o.chunkSize && octaves == o.octaves
+		       && lacunarity == o.lacunarity && gain == o.gain && radiusNum == o.radiusNum && radiusDen == o.radiusDen
+		       && intType == o.intType;
+	}
+};
+
+struct ChunkKeyHash
+{
+	size_t operator()(const ChunkKey& k) const
+	{
+		uint64_t freqBits, lacunarityBits, gainBits;
+		std::memcpy(&freqBits, &k.frequency, sizeof(freqBits));
+		std::memcpy(&lacunarityBits, &k.lacunarity, sizeof(lacunarityBits));
+		std::memcpy(&gainBits, &k.gain, sizeof(gainBits));
+
+		uint64_t h = k.seed ^ (uint64_t(k.intType) << 40) ^ (uint64_t(k.seedType) << 48) ^ (uint64_t(k.mode) << 56)
+		             ^ (uint64_t(k.dimensions) << 60);
+		for (int64_t c : k.chunk)
+		{
+			h = (h ^ uint64_t(c)) * 0x9E3779B97F4A7C15ull;
+			h ^= h >> 29;
+		}
+		for (uint64_t v : { freqBits,
+		                    k.chunkSize ^ (uint64_t(k.octaves) << 40),
+		                    lacunarityBits,
+		                    gainBits,
+		                    uint64_t(k.radiusNum) ^ (uint64_t(k.radiusDen) << 32) })
+		{
+			h = (h ^ v) * 0x9E3779B97F4A7C15ull;
+			h ^= h >> 29;
+		}
+		return size_t(h ^ (h >> 32));
+	}
+};
+
+struct ChunkCacheStats
+{
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+	uint64_t bytes = 0;
+
+	double hit_rate() const { return hits + misses == 0 ? 0.0 : double(hits) / double(hits + misses); }
+};
+
+
+// Thread-safe cache of generated noise chunks, bounded by a memory budget.
+// Lookups are spread over independently locked shards, each evicting its least recently used chunks once it
+// exceeds its share of the budget. Concurrent requests for a chunk that is still being generated wait for the
+// thread generating it instead of generating it again.
+template<typename _Float = float>
+class ChunkCache
+{
+  public:
+	typedef std::shared_ptr<const std::vector<_Float>> chunk_ptr;
+
+  private:
+	struct Entry
+	{
+		std::shared_future<chunk_ptr> value;
+		size_t bytes = 0;
+		bool ready = false;
+		typename std::list<ChunkKey>::iterator lru;
+	};
+
+	struct Shard
+	{
+		std::mutex mutex;
+		std::unordered_map<ChunkKey, Entry, ChunkKeyHash> entries;
+		std::list<ChunkKey> lru;
+		size_t bytes = 0;
+	};
+
+	std::vector<Shard> shards;
+	size_t shardBudget;
+
+	std::atomic<uint64_t> hits{ 0 };
+	std::atomic<uint64_t> misses{ 0 };
+	std::atomic<uint64_t> evictions{ 0 };
+	std::atomic<uint64_t> bytes{ 0 };
+
+	Shard& shard_for(const ChunkKey& key) { return shards[ChunkKeyHash{}(key) % shards.size()]; }
+
+	// Must be called with the shard locked.
+	void evict(Shard& shard)
+	{
+		auto it = shard.lru.end();
+		while (shard.bytes > shardBudget && it != shard.lru.begin())
+		{
+			--it;
+			auto entry = shard.entries.find(*it);
+			if (!entry->second.ready)
+			{
+				continue;
+			}
+
+			shard.bytes -= entry->second.bytes;
+			bytes.fetch_sub(entry->second.bytes, std::memory_order_relaxed);
+			evictions.fetch_add(1, std::memory_order_relaxed);
+			shard.entries.erase(entry);
+			it = shard.lru.erase(it);
+		}
+	}
+
+  public:
+	explicit ChunkCache(size_t memoryBudget, size_t shardCount = 16)
+	    : shards(std::max(shardCount, size_t(1)))
+	    , shardBudget(memoryBudget / std::max(shardCount, size_t(1)))
+	{
+	}
+
+	// Returns the chunk for key, calling generate(std::vector<_Float>&) to fill it if it isn't cached or in flight.
+	// If generate throws, every waiting caller receives the exception and nothing is cached.
+	template<typename _Generate>
+	chunk_ptr get(const ChunkKey& key, _Generate&& generate)
+	{
+		Shard& shard = shard_for(key);
+		std::promise<chunk_ptr> promise;
+		std::shared_future<chunk_ptr> cached;
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			auto it = shard.entries.find(key);
+			if (it != shard.entries.end())
+			{
+				hits.fetch_add(1, std::memory_order_relaxed);
+				shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+				cached = it->second.value;
+			}
+			else
+			{
+				misses.fetch_add(1, std::memory_order_relaxed);
+				Entry& entry = shard.entries[key];
+				entry.value = promise.get_future().share();
+				shard.lru.push_front(key);
+				entry.lru = shard.lru.begin();
+			}
+		}
+
+		// Wait outside the lock, as the generating thread needs it to publish the chunk.
+		if (cached.valid())
+		{
+			return cached.get();
+		}
+
+		chunk_ptr chunk;
+		try
+		{
+			auto values = std::make_shared<std::vector<_Float>>();
+			generate(*values);
+			chunk = std::move(values);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			auto it = shard.entries.find(key);
+			shard.lru.erase(it->second.lru);
+			shard.entries.erase(it);
+			promise.set_exception(std::current_exception());
+			throw;
+		}
+
+		size_t chunkBytes = chunk->size() * sizeof(_Float);
+		promise.set_value(chunk);
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			Entry& entry = shard.entries.find(key)->second;
+			entry.ready = true;
+			entry.bytes = chunkBytes;
+			shard.bytes += chunkBytes;
+			bytes.fetch_add(chunkBytes, std::memory_order_relaxed);
+			evict(shard);
+		}
+		return chunk;
+	}
+
+	// Returns the chunk at the given chunk coordinate, generating chunkSize samples per axis spaced by frequency,
+	// so that sample i of chunk c lies at (c * chunkSize + i) * frequency.
+	template<typename _Noise>
+	chunk_ptr get(
+	      const _Noise& noise,
+	      const std::array<int64_t, _Noise::Dimensions>& chunk,
+	      size_t chunkSize,
+	      double frequency)
+	{
+		constexpr uint32_t _Dimensions = _Noise::Dimensions;
+		static_assert(std::is_same<typename _Noise::float_type, _Float>::value, "Cache and noise value types differ");
+
+		ChunkKey key;
+		key.seed = noise.seed();
+		key.seedType = noise.seed_type();
+		key.mode = _Noise::NoiseMode;
+		key.dimensions = _Dimensions;
+		key.set_kernel<typename _Noise::radius_sq_type, typename _Noise::int_type>();
+		std::copy(chunk.begin(), chunk.end(), key.chunk.begin());
+		key.frequency = frequency;
+		key.chunkSize = chunkSize;
+
+		return get(key, [&](std::vector<_Float>& values) {
+			std::array<size_t, _Dimensions> size;
+			std::array<_Float, _Dimensions> origin;
+			size_t count = 1;
+			for (uint32_t k = 0; k < _Dimensions; ++k)
+			{
+				size[k] = chunkSize;
+				origin[k] = _Float(double(chunk[k]) * double(chunkSize) * frequency);
+				count *= chunkSize;
+			}
+			values.resize(count);
+			noise.generate(values.data(), size, origin, _Float(frequency));
+		});
+	}
+
+	ChunkCacheStats stats() const
+	{
+		ChunkCacheStats s;
+		s.hits = hits.load(std::memory_order_relaxed);
+		s.misses = misses.load(std::memory_order_relaxed);
+		s.evictions = evictions.load(std::memory_order_relaxed);
+		s.bytes = bytes.load(std::memory_order_relaxed);
+		return s;
+	}
+
+	// Drops every generated chunk. Chunks still in flight are kept so their waiters are not orphaned.
+	void clear()
+	{
+		for (Shard& shard : shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			for (auto it = shard.lru.begin(); it != shard.lru.end();)
+			{
+				auto entry = shard.entries.find(*it);
+				if (entry->second.ready)
+				{
+					shard.bytes -= entry->second.bytes;
+					bytes.fetch_sub(entry->second.bytes, std::memory_order_relaxed);
+					shard.entries.erase(entry);
+					it = shard.lru.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+		}
+	}
+};
+
+} // namespace osn
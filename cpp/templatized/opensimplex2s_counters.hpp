@@ -0,0 +1,137 @@
+#pragma once
+
+// Per-thread instrumentation of the lattice traversal in noise_impl<2/3/4>::eval.
+// Only compiled in when OSN_ENABLE_COUNTERS is defined before including opensimplex2s.hpp; otherwise OSN_COUNT
+// expands to nothing and the kernels are unchanged.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+
+namespace osn
+{
+
+template<typename _T>
+struct basic_noise_counters
+{
+	_T evaluations2D, candidates2D, contributions2D;
+	_T evaluations3D, candidates3D, contributions3D;
+	_T evaluations4D, candidates4D, contributions4D;
+
+	// Transitions taken out of each 3D lattice block, through NextLatticeIndexBlockFailure/Success.
+	_T blockFailure[14], blockSuccess[14];
+
+	// Histogram of 4D candidate row lengths, points[index].first.
+	_T rowLength[21];
+
+	// Calls f(a.x, b.x) for every counter x of a and b.
+	template<typename _A, typename _B, typename _F>
+	static void for_each(_A& a, _B& b, _F&& f)
+	{
+		f(a.evaluations2D, b.evaluations2D);
+		f(a.candidates2D, b.candidates2D);
+		f(a.contributions2D, b.contributions2D);
+		f(a.evaluations3D, b.evaluations3D);
+		f(a.candidates3D, b.candidates3D);
+		f(a.contributions3D, b.contributions3D);
+		f(a.evaluations4D, b.evaluations4D);
+		f(a.candidates4D, b.candidates4D);
+		f(a.contributions4D, b.contributions4D);
+		for (size_t i = 0; i < 14; ++i)
+		{
+			f(a.blockFailure[i], b.blockFailure[i]);
+			f(a.blockSuccess[i], b.blockSuccess[i]);
+		}
+		for (size_t i = 0; i < 21; ++i)
+		{
+			f(a.rowLength[i], b.rowLength[i]);
+		}
+	}
+};
+
+typedef basic_noise_counters<uint64_t> NoiseCounters;
+
+namespace _detail
+{
+	// Written only by its owning thread, so increments need no read-modify-write; other threads read it relaxed.
+	struct thread_counter
+	{
+		std::atomic<uint64_t> value{ 0 };
+
+		void increment() { value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+		uint64_t get() const { return value.load(std::memory_order_relaxed); }
+	};
+
+	struct counter_registry
+	{
+		std::mutex mutex;
+		std::vector<const basic_noise_counters<thread_counter>*> live;
+		NoiseCounters retired{};
+
+		static counter_registry& instance()
+		{
+			static counter_registry registry;
+			return registry;
+		}
+	};
+
+	struct thread_counters : basic_noise_counters<thread_counter>
+	{
+		thread_counters()
+		{
+			counter_registry& r = counter_registry::instance();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.live.push_back(this);
+		}
+
+		~thread_counters()
+		{
+			counter_registry& r = counter_registry::instance();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			basic_noise_counters<thread_counter>::for_each(
+			      r.retired,
+			      *this,
+			      [](uint64_t& total, const thread_counter& c) { total += c.get(); });
+			r.live.erase(std::find(r.live.begin(), r.live.end(), this));
+		}
+
+		static thread_counters& local()
+		{
+			thread_local thread_counters counters;
+			return counters;
+		}
+	};
+
+} // namespace _detail
+
+// Sum of the counters of every thread, including threads that have exited.
+inline NoiseCounters counters_snapshot()
+{
+	_detail::counter_registry& r = _detail::counter_registry::instance();
+	std::lock_guard<std::mutex> lock(r.mutex);
+
+	NoiseCounters total = r.retired;
+	for (const basic_noise_counters<_detail::thread_counter>* t : r.live)
+	{
+		NoiseCounters::for_each(total, *t, [](uint64_t& sum, const _detail::thread_counter& c) { sum += c.get(); });
+	}
+	return total;
+}
+
+// Counts of the calling thread only.
+inline NoiseCounters thread_counters_snapshot()
+{
+	NoiseCounters total{};
+	NoiseCounters::for_each(
+	      total,
+	      _detail::thread_counters::local(),
+	      [](uint64_t& sum, const _detail::thread_counter& c) { sum = c.get(); });
+	return total;
+}
+
+} // namespace osn
+
+#define OSN_COUNT(...) ::osn::_detail::thread_counters::local().__VA_ARGS__.increment()
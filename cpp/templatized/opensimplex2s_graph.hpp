@@ -0,0 +1,661 @@
+#pragma once
+
+#include "opensimplex2s.hpp"
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+
+namespace osn
+{
+
+enum class NoiseOp : uint32_t
+{
+	Constant,
+	Coordinate,
+	Noise,
+	Fbm,
+	Ridged,
+	Add,
+	Multiply,
+	Min,
+	Max,
+	Abs,
+	Affine,
+	Clamp,
+	Blend,
+	Select
+};
+
+// A DAG of noise nodes layered over one OpenSimplex2S instance, e.g. a terrain height function.
+// Nodes are built bottom-up and identified by index. Building folds constant subgraphs and simple identities
+// (x * 1, x + 0, affine of affine, ...) and returns the existing node for any node built twice, so shared
+// subexpressions are computed once. compile() turns the part of the graph an output depends on into a program.
+template<typename _Noise>
+class NoiseGraph
+{
+  public:
+	typedef typename _Noise::float_type float_type;
+	typedef uint32_t Node;
+
+	static constexpr uint32_t Dimensions = _Noise::Dimensions;
+	static constexpr Node None = ~Node(0);
+	static constexpr uint32_t MaxInputs = Dimensions > 3 ? Dimensions : 3;
+
+	struct NodeData
+	{
+		NoiseOp op = NoiseOp::Constant;
+		std::array<Node, MaxInputs> in;
+		std::array<float_type, 4> param{};
+		uint32_t octaves = 0;
+
+		NodeData() { in.fill(None); }
+
+		bool operator<(const NodeData& o) const
+		{
+			return std::tie(op, in, param, octaves) < std::tie(o.op, o.in, o.param, o.octaves);
+		}
+	};
+
+	class Program;
+
+  private:
+	const _Noise& noise;
+	std::vector<NodeData> nodes;
+	std::map<NodeData, Node> interned;
+
+	bool is_constant(Node n) const { return nodes[n].op == NoiseOp::Constant; }
+	float_type value(Node n) const { return nodes[n].param[0]; }
+
+	Node intern(const NodeData& data)
+	{
+		auto it = interned.find(data);
+		if (it != interned.end())
+		{
+			return it->second;
+		}
+		nodes.push_back(data);
+		interned.emplace(data, Node(nodes.size() - 1));
+		return Node(nodes.size() - 1);
+	}
+
+	Node make(NoiseOp op, std::initializer_list<Node> in, std::array<float_type, 4> param = {}, uint32_t octaves = 0)
+	{
+		NodeData data;
+		data.op = op;
+		std::copy(in.begin(), in.end(), data.in.begin());
+		data.param = param;
+		data.octaves = octaves;
+
+		// Commutative operations take their inputs in a canonical order, so that a + b and b + a are shared.
+		if (op == NoiseOp::Add || op == NoiseOp::Multiply || op == NoiseOp::Min || op == NoiseOp::Max)
+		{
+			if (data.in[1] < data.in[0])
+			{
+				std::swap(data.in[0], data.in[1]);
+			}
+		}
+		return intern(data);
+	}
+
+	Node lattice_node(
+	      NoiseOp op,
+	      float_type frequency,
+	      uint32_t octaves,
+	      float_type lacunarity,
+	      float_type gain,
+	      float_type offset,
+	      const std::array<Node, Dimensions>& warp)
+	{
+		NodeData data;
+		data.op = op;
+		std::copy(warp.begin(), warp.end(), data.in.begin());
+		for (uint32_t k = 0; k < Dimensions; ++k)
+		{
+			// A constant warp is a shift of the whole domain.
+			if (data.in[k] != None && is_constant(data.in[k]) && value(data.in[k]) == 0)
+			{
+				data.in[k] = None;
+			}
+		}
+		data.param = { frequency, lacunarity, gain, offset };
+		data.octaves = octaves;
+		return intern(data);
+	}
+
+	static float_type smoothstep(float_type t)
+	{
+		t = std::min(std::max(t, float_type(0)), float_type(1));
+		return t * t * (3 - 2 * t);
+	}
+
+  public:
+	explicit NoiseGraph(const _Noise& noise)
+	    : noise(noise)
+	{
+	}
+
+	const NodeData& node(Node n) const { return nodes[n]; }
+	size_t size() const { return nodes.size(); }
+
+	Node constant(float_type v) { return make(NoiseOp::Constant, {}, { v }); }
+
+	// Sample position along axis k.
+	Node coordinate(uint32_t k) { return make(NoiseOp::Coordinate, {}, { float_type(k) }); }
+
+	// The noise at (p + warp) * frequency + offset, where warp holds a node per axis or None. Distinct offsets
+	// give uncorrelated layers of the same noise.
+	Node noise_at(float_type frequency, float_type offset = 0, const std::array<Node, Dimensions>& warp = unwarped())
+	{
+		return lattice_node(NoiseOp::Noise, frequency, 1, 1, 1, offset, warp);
+	}
+
+	Node fbm(
+	      float_type frequency,
+	      uint32_t octaves,
+	      float_type lacunarity = 2,
+	      float_type gain = float_type(0.5),
+	      float_type offset = 0,
+	      const std::array<Node, Dimensions>& warp = unwarped())
+	{
+		if (octaves == 0)
+		{
+			return constant(0);
+		}
+		return lattice_node(NoiseOp::Fbm, frequency, octaves, lacunarity, gain, offset, warp);
+	}
+
+	// Sums (1 - |noise|)^2 over octaves like fbm(), giving sharp crests where the noise crosses zero.
+	Node ridged(
+	      float_type frequency,
+	      uint32_t octaves,
+	      float_type lacunarity = 2,
+	      float_type gain = float_type(0.5),
+	      float_type offset = 0,
+	      const std::array<Node, Dimensions>& warp = unwarped())
+	{
+		if (octaves == 0)
+		{
+			return constant(0);
+		}
+		return lattice_node(NoiseOp::Ridged, frequency, octaves, lacunarity, gain, offset, warp);
+	}
+
+	static std::array<Node, Dimensions> unwarped()
+	{
+		std::array<Node, Dimensions> warp;
+		warp.fill(None);
+		return warp;
+	}
+
+	// a * scale + bias.
+	Node affine(Node a, float_type scale, float_type bias)
+	{
+		if (is_constant(a))
+		{
+			return constant(value(a) * scale + bias);
+		}
+		if (scale == 0)
+		{
+			return constant(bias);
+		}
+		if (scale == 1 && bias == 0)
+		{
+			return a;
+		}
+		if (nodes[a].op == NoiseOp::Affine)
+		{
+			const NodeData& inner = nodes[a];
+			return affine(inner.in[0], inner.param[0] * scale, inner.param[1] * scale + bias);
+		}
+		return make(NoiseOp::Affine, { a }, { scale, bias });
+	}
+
+	// Maps [inLo, inHi] linearly onto [outLo, outHi], without clamping.
+	Node remap(Node a, float_type inLo, float_type inHi, float_type outLo, float_type outHi)
+	{
+		float_type scale = (outHi - outLo) / (inHi - inLo);
+		return affine(a, scale, outLo - inLo * scale);
+	}
+
+	Node add(Node a, Node b)
+	{
+		if (is_constant(b))
+		{
+			return affine(a, 1, value(b));
+		}
+		if (is_constant(a))
+		{
+			return affine(b, 1, value(a));
+		}
+		return make(NoiseOp::Add, { a, b });
+	}
+
+	Node multiply(Node a, Node b)
+	{
+		if (is_constant(b))
+		{
+			return affine(a, value(b), 0);
+		}
+		if (is_constant(a))
+		{
+			return affine(b, value(a), 0);
+		}
+		return make(NoiseOp::Multiply, { a, b });
+	}
+
+	Node clamp(Node a, float_type lo, float_type hi)
+	{
+		if (is_constant(a))
+		{
+			return constant(std::min(std::max(value(a), lo), hi));
+		}
+		if (nodes[a].op == NoiseOp::Clamp)
+		{
+			const NodeData& inner = nodes[a];
+			lo = std::min(std::max(inner.param[0], lo), hi);
+			hi = std::max(std::min(inner.param[1], hi), lo);
+			return clamp(inner.in[0], lo, hi);
+		}
+		return make(NoiseOp::Clamp, { a }, { lo, hi });
+	}
+
+	Node min(Node a, Node b)
+	{
+		if (is_constant(b))
+		{
+			return clamp(a, -std::numeric_limits<float_type>::infinity(), value(b));
+		}
+		if (is_constant(a))
+		{
+			return clamp(b, -std::numeric_limits<float_type>::infinity(), value(a));
+		}
+		return a == b ? a : make(NoiseOp::Min, { a, b });
+	}
+
+	Node max(Node a, Node b)
+	{
+		if (is_constant(b))
+		{
+			return clamp(a, value(b), std::numeric_limits<float_type>::infinity());
+		}
+		if (is_constant(a))
+		{
+			return clamp(b, value(a), std::numeric_limits<float_type>::infinity());
+		}
+		return a == b ? a : make(NoiseOp::Max, { a, b });
+	}
+
+	Node abs(Node a)
+	{
+		if (is_constant(a))
+		{
+			return constant(std::abs(value(a)));
+		}
+		return nodes[a].op == NoiseOp::Abs ? a : make(NoiseOp::Abs, { a });
+	}
+
+	// a + (b - a) * t.
+	Node blend(Node a, Node b, Node t)
+	{
+		if (a == b)
+		{
+			return a;
+		}
+		if (is_constant(t))
+		{
+			if (value(t) == 0)
+			{
+				return a;
+			}
+			if (value(t) == 1)
+			{
+				return b;
+			}
+		}
+		if (is_constant(a) && is_constant(b) && is_constant(t))
+		{
+			return constant(value(a) + (value(b) - value(a)) * value(t));
+		}
+		return make(NoiseOp::Blend, { a, b, t });
+	}
+
+	// a where control is below threshold - falloff, b above threshold + falloff, and a smooth blend in between.
+	Node select(Node a, Node b, Node control, float_type threshold, float_type falloff = 0)
+	{
+		if (is_constant(control))
+		{
+			float_type c = value(control);
+			float_type t = falloff > 0 ? smoothstep((c - threshold + falloff) / (2 * falloff)) : float_type(c >= threshold);
+			return blend(a, b, constant(t));
+		}
+		if (a == b)
+		{
+			return a;
+		}
+		return make(NoiseOp::Select, { a, b, control }, { threshold, falloff });
+	}
+
+	Program compile(Node output) const { return Program(*this, output); }
+
+
+	// A compiled graph, evaluated over grids tile by tile: every node of a tile is computed before the next tile
+	// starts, into a few tile-sized buffers reused as soon as their last reader has run, so that intermediates stay
+	// in cache instead of filling full-size buffers.
+	class Program
+	{
+		struct Instruction
+		{
+			NodeData node;
+			uint32_t out;
+			std::array<uint32_t, MaxInputs> in;
+		};
+
+		const _Noise& noise;
+		std::vector<Instruction> instructions;
+		uint32_t slotCount = Dimensions;
+		uint32_t result = 0;
+
+		template<size_t... _K>
+		static float_type sample(
+		      const _Noise& noise,
+		      const NodeData& node,
+		      const std::array<float_type, Dimensions>& p,
+		      std::index_sequence<_K...>)
+		{
+			float_type frequency = node.param[0], lacunarity = node.param[1], gain = node.param[2];
+			float_type offset = node.param[3];
+			if (node.op == NoiseOp::Noise)
+			{
+				return noise((p[_K] * frequency + offset)...);
+			}
+			if (node.op == NoiseOp::Fbm)
+			{
+				return noise.fbm(node.octaves, lacunarity, gain, (p[_K] * frequency + offset)...);
+			}
+
+			float_type value = 0, amplitude = 1;
+			for (uint32_t o = 0; o < node.octaves; ++o)
+			{
+				float_type r = 1 - std::abs(noise((p[_K] * frequency + offset)...));
+				value += amplitude * r * r;
+				amplitude *= gain;
+				frequency *= lacunarity;
+			}
+			return value;
+		}
+
+		// Where a tile lies in the grid being generated.
+		struct Tile
+		{
+			std::array<size_t, Dimensions> size;
+			std::array<float_type, Dimensions> origin;
+			float_type step;
+			std::array<size_t, Dimensions> start;
+			size_t length;
+		};
+
+		// An unwarped lattice node samples an affine grid, so each x run of the tile is filled by _Noise::generate()
+		// once per octave instead of evaluating the noise point by point. fbm() scales the offset with each octave.
+		void fill_lattice(const NodeData& node, const Tile& tile, float_type* out, float_type* scratch) const
+		{
+			float_type frequency = node.param[0], lacunarity = node.param[1], gain = node.param[2];
+			float_type shift = node.param[3], amplitude = 1;
+			float_type* octave = node.op == NoiseOp::Noise ? out : scratch;
+			if (node.op != NoiseOp::Noise)
+			{
+				std::fill(out, out + tile.length, float_type(0));
+			}
+			for (uint32_t o = 0; o < node.octaves; ++o)
+			{
+				std::array<size_t, Dimensions> idx = tile.start, run;
+				run.fill(1);
+				for (size_t i = 0; i < tile.length; i += run[0])
+				{
+					run[0] = std::min(tile.length - i, tile.size[0] - idx[0]);
+					std::array<float_type, Dimensions> origin;
+					for (uint32_t k = 0; k < Dimensions; ++k)
+					{
+						origin[k] = (tile.origin[k] + float_type(idx[k]) * tile.step) * frequency + shift;
+					}
+					noise.generate(octave + i, run, origin, tile.step * frequency);
+
+					idx[0] += run[0];
+					for (uint32_t k = 0; k < Dimensions && idx[k] == tile.size[k]; ++k)
+					{
+						idx[k] = 0;
+						if (k + 1 < Dimensions)
+						{
+							++idx[k + 1];
+						}
+					}
+				}
+
+				if (node.op == NoiseOp::Fbm)
+				{
+					for (size_t i = 0; i < tile.length; ++i)
+						out[i] += amplitude * scratch[i];
+					shift *= lacunarity;
+				}
+				else if (node.op == NoiseOp::Ridged)
+				{
+					for (size_t i = 0; i < tile.length; ++i)
+					{
+						float_type r = 1 - std::abs(scratch[i]);
+						out[i] += amplitude * r * r;
+					}
+				}
+				amplitude *= gain;
+				frequency *= lacunarity;
+			}
+		}
+
+		void run(const Instruction& ins, std::vector<float_type>& slots, size_t tileSize, const Tile& tile) const
+		{
+			size_t n = tile.length;
+			float_type* out = &slots[ins.out * tileSize];
+			std::array<const float_type*, MaxInputs> in;
+			for (uint32_t k = 0; k < MaxInputs; ++k)
+			{
+				in[k] = ins.in[k] != None ? &slots[ins.in[k] * tileSize] : nullptr;
+			}
+			const std::array<float_type, 4>& param = ins.node.param;
+			switch (ins.node.op)
+			{
+			case NoiseOp::Constant:
+				std::fill(out, out + n, param[0]);
+				break;
+			case NoiseOp::Coordinate:
+				break;
+			case NoiseOp::Noise:
+			case NoiseOp::Fbm:
+			case NoiseOp::Ridged:
+				if (std::all_of(in.begin(), in.begin() + Dimensions, [](const float_type* w) { return !w; }))
+				{
+					fill_lattice(ins.node, tile, out, &slots[slotCount * tileSize]);
+					break;
+				}
+				for (size_t i = 0; i < n; ++i)
+				{
+					std::array<float_type, Dimensions> p;
+					for (uint32_t k = 0; k < Dimensions; ++k)
+					{
+						p[k] = slots[k * tileSize + i] + (in[k] ? in[k][i] : float_type(0));
+					}
+					out[i] = sample(noise, ins.node, p, std::make_index_sequence<Dimensions>());
+				}
+				break;
+			case NoiseOp::Add:
+				for (size_t i = 0; i < n; ++i)
+					out[i] = in[0][i] + in[1][i];
+				break;
+			case NoiseOp::Multiply:
+				for (size_t i = 0; i < n; ++i)
+					out[i] = in[0][i] * in[1][i];
+				break;
+			case NoiseOp::Min:
+				for (size_t i = 0; i < n; ++i)
+					out[i] = std::min(in[0][i], in[1][i]);
+				break;
+			case NoiseOp::Max:
+				for (size_t i = 0; i < n; ++i)
+					out[i] = std::max(in[0][i], in[1][i]);
+				break;
+			case NoiseOp::Abs:
+				for (size_t i = 0; i < n; ++i)
+					out[i] = std::abs(in[0][i]);
+				break;
+			case NoiseOp::Affine:
+				for (size_t i = 0; i < n; ++i)
+					out[i] = in[0][i] * param[0] + param[1];
+				break;
+			case NoiseOp::Clamp:
+				for (size_t i = 0; i < n; ++i)
+					out[i] = std::min(std::max(in[0][i], param[0]), param[1]);
+				break;
+			case NoiseOp::Blend:
+				for (size_t i = 0; i < n; ++i)
+					out[i] = in[0][i] + (in[1][i] - in[0][i]) * in[2][i];
+				break;
+			case NoiseOp::Select:
+				for (size_t i = 0; i < n; ++i)
+				{
+					float_type t = param[1] > 0 ? smoothstep((in[2][i] - param[0] + param[1]) / (2 * param[1]))
+					                            : float_type(in[2][i] >= param[0]);
+					out[i] = in[0][i] + (in[1][i] - in[0][i]) * t;
+				}
+				break;
+			}
+		}
+
+	  public:
+		Program(const NoiseGraph& graph, Node output)
+		    : noise(graph.noise)
+		{
+			// Nodes are created after their inputs, so ascending index order is a topological order.
+			std::vector<bool> live(graph.size(), false);
+			live[output] = true;
+			for (Node n = output + 1; n-- > 0;)
+			{
+				if (live[n])
+				{
+					for (Node i : graph.node(n).in)
+					{
+						if (i != None)
+						{
+							live[i] = true;
+						}
+					}
+				}
+			}
+
+			std::vector<uint32_t> lastUse(graph.size(), 0);
+			for (Node n = 0; n <= output; ++n)
+			{
+				for (Node i : graph.node(n).in)
+				{
+					if (live[n] && i != None)
+					{
+						lastUse[i] = n;
+					}
+				}
+			}
+
+			// Coordinates live in the first slots for the whole tile; other slots are recycled after their last use.
+			std::vector<uint32_t> slotOf(graph.size(), None), freeSlots;
+			for (Node n = 0; n <= output; ++n)
+			{
+				if (!live[n])
+				{
+					continue;
+				}
+				const NodeData& data = graph.node(n);
+				Instruction ins{ data, 0, {} };
+				ins.in.fill(None);
+				for (uint32_t k = 0; k < MaxInputs; ++k)
+				{
+					if (data.in[k] != None)
+					{
+						ins.in[k] = slotOf[data.in[k]];
+					}
+				}
+				for (uint32_t k = 0; k < MaxInputs; ++k)
+				{
+					if (data.in[k] != None && lastUse[data.in[k]] == n && graph.node(data.in[k]).op != NoiseOp::Coordinate
+					    && std::find(freeSlots.begin(), freeSlots.end(), slotOf[data.in[k]]) == freeSlots.end())
+					{
+						freeSlots.push_back(slotOf[data.in[k]]);
+					}
+				}
+
+				if (data.op == NoiseOp::Coordinate)
+				{
+					ins.out = uint32_t(data.param[0]);
+				}
+				else if (!freeSlots.empty())
+				{
+					ins.out = freeSlots.back();
+					freeSlots.pop_back();
+				}
+				else
+				{
+					ins.out = slotCount++;
+				}
+				slotOf[n] = ins.out;
+				instructions.push_back(ins);
+			}
+			result = slotOf[output];
+		}
+
+		size_t instruction_count() const { return instructions.size(); }
+		size_t slot_count() const { return slotCount; }
+
+		// Fills out like _Noise::generate() would, with the graph's output at each sample position
+		// origin + index * step; x varies fastest. Tiles hold tileSize consecutive samples.
+		void generate(
+		      float_type* out,
+		      const std::array<size_t, Dimensions>& size,
+		      const std::array<float_type, Dimensions>& origin,
+		      float_type step,
+		      size_t tileSize = 4096) const
+		{
+			size_t total = 1;
+			for (size_t s : size)
+			{
+				total *= s;
+			}
+			tileSize = std::max(std::min(tileSize, total), size_t(1));
+			// One slot past the program's holds the octaves of unwarped lattice nodes.
+			std::vector<float_type> slots((slotCount + 1) * tileSize);
+
+			Tile tile{ size, origin, step, {}, 0 };
+			std::array<size_t, Dimensions> idx{};
+			for (size_t first = 0; first < total; first += tileSize)
+			{
+				size_t n = std::min(tileSize, total - first);
+				tile.start = idx;
+				tile.length = n;
+				for (size_t i = 0; i < n; ++i)
+				{
+					for (uint32_t k = 0; k < Dimensions; ++k)
+					{
+						slots[k * tileSize + i] = origin[k] + float_type(idx[k]) * step;
+					}
+					for (uint32_t k = 0; k < Dimensions && ++idx[k] == size[k]; ++k)
+					{
+						idx[k] = 0;
+					}
+				}
+
+				for (const Instruction& ins : instructions)
+				{
+					run(ins, slots, tileSize, tile);
+				}
+				std::copy(&slots[result * tileSize], &slots[result * tileSize] + n, out + first);
+			}
+		}
+	};
+};
+
+} // namespace osn
@@ -0,0 +1,385 @@
+#pragma once
+
+#include "opensimplex2s.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace osn
+{
+
+enum class PerfEvent
+{
+	Cycles,
+	Instructions,
+	L1DMisses,
+	LLCMisses,
+	BranchMisses,
+	Count
+};
+
+// Event totals over a measured span, scaled up where the kernel multiplexed a counter. Events that could not be
+// opened are NaN; hardware is false when none could, leaving only the wall-clock time.
+struct PerfSample
+{
+	double seconds = 0;
+	bool hardware = false;
+	std::array<double, size_t(PerfEvent::Count)> events{};
+
+	double operator[](PerfEvent e) const { return events[size_t(e)]; }
+};
+
+// Hardware counters of the calling thread, in user space, through perf_event_open. Each event is opened on its own,
+// so a CPU or hypervisor lacking one still reports the others. Containers, a strict perf_event_paranoid and non-Linux
+// builds usually allow none; then available() is false and samples carry only the wall-clock time.
+class PerfCounters
+{
+	std::array<int, size_t(PerfEvent::Count)> fds;
+	std::string error;
+	std::chrono::time_point<std::chrono::steady_clock> started;
+
+#ifdef __linux__
+	static int open_event(uint32_t type, uint64_t config)
+	{
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		return int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+#endif
+
+  public:
+	PerfCounters()
+	{
+		fds.fill(-1);
+#ifdef __linux__
+		const uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+		                             | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		const std::array<std::pair<uint32_t, uint64_t>, size_t(PerfEvent::Count)> events{
+			{ { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			  { PERF_TYPE_HW_CACHE, l1dReadMiss },
+			  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES } }
+		};
+		for (size_t e = 0; e < events.size(); ++e)
+		{
+			fds[e] = open_event(events[e].first, events[e].second);
+			if (fds[e] < 0 && error.empty())
+			{
+				error = std::string("perf_event_open: ") + std::strerror(errno);
+			}
+		}
+#else
+		error = "hardware counters need Linux perf_event_open";
+#endif
+	}
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	~PerfCounters()
+	{
+#ifdef __linux__
+		for (int fd : fds)
+		{
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+		}
+#endif
+	}
+
+	bool available() const
+	{
+		for (int fd : fds)
+		{
+			if (fd >= 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Why an event could not be opened, or empty if all were.
+	const std::string& unavailable_reason() const { return error; }
+
+	void start()
+	{
+#ifdef __linux__
+		for (int fd : fds)
+		{
+			if (fd >= 0)
+			{
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+#endif
+		started = std::chrono::steady_clock::now();
+	}
+
+	PerfSample stop()
+	{
+		PerfSample sample;
+		sample.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		sample.events.fill(std::nan(""));
+#ifdef __linux__
+		for (size_t e = 0; e < fds.size(); ++e)
+		{
+			if (fds[e] < 0)
+			{
+				continue;
+			}
+			ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+			uint64_t values[3];
+			if (read(fds[e], values, sizeof(values)) == ssize_t(sizeof(values)) && values[2] > 0)
+			{
+				sample.events[e] = double(values[0]) * double(values[1]) / double(values[2]);
+				sample.hardware = true;
+			}
+		}
+#endif
+		return sample;
+	}
+};
+
+
+enum class ProfilePattern
+{
+	Grid,      // A regular grid spaced by 0.05, x varying fastest.
+	Scattered  // Uniform over [-4096, 4096] on every axis, which spreads the hash over all of perm and permGrad.
+};
+
+// Per-point cost of one noise kernel under an access pattern. The points are evaluated in three passes: only read,
+// so the pattern's own cost is known; through the lattice traversal with a fixed gradient, which walks the pregen
+// lattice tables and does all of the kernel's arithmetic except hashing the lattice coordinates; and in full. The
+// traversal's cost over the read is the traversal row, and the full evaluation's over the traversal is the gradient
+// hash row: the perm hash arithmetic together with its perm and permGrad loads, which counters cannot tell apart.
+// Each pass is repeated and its minimum kept. A difference no larger than the two passes' spreads over the repeats
+// is reported as inconclusive rather than as a cost of either sign.
+struct KernelProfile
+{
+	std::string name;
+	size_t points = 0;
+	size_t repeats = 0;
+	// Minimum over the repeats, each event and the time on their own.
+	PerfSample stream, lattice, full;
+	// Largest minus smallest over the repeats.
+	PerfSample streamSpread, latticeSpread, fullSpread;
+	std::string unavailable;
+
+	void report(std::ostream& out) const
+	{
+		static const char* const names[] = { "cycles", "instructions", "L1D misses", "LLC misses", "branch misses" };
+		auto cell = [&](int width, double a, double b, double noise) {
+			out << std::setw(width);
+			if (std::isnan(a - b))
+			{
+				out << "n/a";
+			}
+			else if (std::abs(a - b) <= noise && noise > 0)
+			{
+				out << "inconclusive";
+			}
+			else
+			{
+				out << (a - b) / double(points);
+			}
+		};
+		auto row = [&](const char* label,
+		               const PerfSample& a,
+		               const PerfSample& aSpread,
+		               const PerfSample* b,
+		               const PerfSample* bSpread) {
+			out << "  " << std::left << std::setw(16) << label << std::right << std::fixed << std::setprecision(2);
+			if (b)
+			{
+				cell(14, 1e9 * a.seconds, 1e9 * b->seconds, 1e9 * (aSpread.seconds + bSpread->seconds));
+			}
+			else
+			{
+				cell(14, 1e9 * a.seconds, 0, 0);
+			}
+			for (size_t e = 0; e < size_t(PerfEvent::Count); ++e)
+			{
+				if (b)
+				{
+					cell(14, a.events[e], b->events[e], aSpread.events[e] + bSpread->events[e]);
+				}
+				else
+				{
+					cell(14, a.events[e], 0, 0);
+				}
+			}
+			out << "\n";
+		};
+
+		out << name << ", per point over " << points << " points, best of " << repeats;
+		if (!full.hardware)
+		{
+			out << " (wall-clock only: " << unavailable << ")";
+		}
+		out << "\n  " << std::left << std::setw(16) << "" << std::right << std::setw(14) << "ns";
+		for (const char* n : names)
+		{
+			out << std::setw(14) << n;
+		}
+		out << "\n";
+		row("points only", stream, streamSpread, nullptr, nullptr);
+		row("traversal", lattice, latticeSpread, &stream, &streamSpread);
+		row("gradient hash", full, fullSpread, &lattice, &latticeSpread);
+		row("total", full, fullSpread, nullptr, nullptr);
+		out.unsetf(std::ios_base::floatfield);
+		out << std::setprecision(6);
+	}
+};
+
+template<typename _Noise>
+KernelProfile profile_kernel(
+      const _Noise& noise,
+      ProfilePattern pattern,
+      size_t count,
+      std::string name,
+      size_t repeats = 5)
+{
+	typedef typename _Noise::float_type float_type;
+	constexpr uint32_t D = _Noise::Dimensions;
+	typedef std::array<float_type, D> point_t;
+	typedef _detail::noise_mode_impl<D, Mode, _Noise::NoiseMode> mode_impl_t;
+	typedef _detail::noise_impl<D, float_type, typename _Noise::int_type, typename _Noise::radius_sq_type> noise_t;
+
+	std::vector<point_t> points(count);
+	if (pattern == ProfilePattern::Grid)
+	{
+		size_t side = size_t(std::ceil(std::pow(double(count), 1.0 / D)));
+		for (size_t n = 0; n < count; ++n)
+		{
+			size_t rest = n;
+			for (uint32_t k = 0; k < D; ++k)
+			{
+				points[n][k] = float_type(0.05 * double(rest % side));
+				rest /= side;
+			}
+		}
+	}
+	else
+	{
+		std::mt19937_64 rng(1);
+		std::uniform_real_distribution<double> coordinate(-4096, 4096);
+		for (point_t& p : points)
+		{
+			for (float_type& v : p)
+			{
+				v = float_type(coordinate(rng));
+			}
+		}
+	}
+
+	_detail::grad<D, float_type> fixed;
+	for (uint32_t k = 0; k < D; ++k)
+	{
+		fixed.v[k] = float_type(1);
+	}
+	auto fixedGradient = [&](const auto&, auto...) -> const _detail::grad<D, float_type>& { return fixed; };
+
+	// The sums are kept so that no pass can be optimized away.
+	volatile float_type sink = 0;
+	auto pass = [&](PerfCounters& counters, auto&& eval) {
+		float_type sum = 0;
+		for (size_t n = 0; n < std::min<size_t>(count, 1024); ++n)
+		{
+			sum += eval(points[n]);
+		}
+		counters.start();
+		for (const point_t& p : points)
+		{
+			sum += eval(p);
+		}
+		PerfSample sample = counters.stop();
+		sink = sink + sum;
+		return sample;
+	};
+
+	// Keeps the minimum of every measure in best and their spread in spread, which holds the maximum until the end.
+	auto keep = [](size_t r, const PerfSample& sample, PerfSample& best, PerfSample& spread) {
+		if (r == 0)
+		{
+			best = spread = sample;
+			return;
+		}
+		best.seconds = std::min(best.seconds, sample.seconds);
+		spread.seconds = std::max(spread.seconds, sample.seconds);
+		for (size_t e = 0; e < size_t(PerfEvent::Count); ++e)
+		{
+			best.events[e] = std::min(best.events[e], sample.events[e]);
+			spread.events[e] = std::max(spread.events[e], sample.events[e]);
+		}
+	};
+	auto finish = [](const PerfSample& best, PerfSample& spread) {
+		spread.seconds -= best.seconds;
+		for (size_t e = 0; e < size_t(PerfEvent::Count); ++e)
+		{
+			spread.events[e] -= best.events[e];
+		}
+	};
+
+	PerfCounters counters;
+	KernelProfile profile;
+	profile.name = std::move(name);
+	profile.points = count;
+	profile.repeats = std::max<size_t>(repeats, 1);
+	profile.unavailable = counters.unavailable_reason();
+	// The passes take turns, so that a slow spell of the machine does not land on one of them only.
+	for (size_t r = 0; r < profile.repeats; ++r)
+	{
+		PerfSample stream = pass(counters, [](const point_t& p) {
+			float_type sum = 0;
+			for (float_type v : p)
+			{
+				sum += v;
+			}
+			return sum;
+		});
+		keep(r, stream, profile.stream, profile.streamSpread);
+		PerfSample lattice = pass(counters, [&](const point_t& p) {
+			return std::apply(
+			      [&](auto... v) { return noise_t::eval_with(fixedGradient, v...); },
+			      std::apply([](auto... v) { return mode_impl_t::transform(v...); }, p));
+		});
+		keep(r, lattice, profile.lattice, profile.latticeSpread);
+		PerfSample full = pass(counters, [&](const point_t& p) {
+			return std::apply([&](auto... v) { return noise(v...); }, p);
+		});
+		keep(r, full, profile.full, profile.fullSpread);
+	}
+	finish(profile.stream, profile.streamSpread);
+	finish(profile.lattice, profile.latticeSpread);
+	finish(profile.full, profile.fullSpread);
+	return profile;
+}
+
+} // namespace osn
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "opensimplex2s.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+namespace osn
+{
+
+// Levels of detail of a square 2D region of fractal noise. Level l samples every 2^l-th point of level 0, so pixel
+// (i, j) lies at (x0 + i * 2^l * step, y0 + j * 2^l * step), x varying fastest, and sums the first octaves(l) octaves
+// of gain^o * noise(p * lacunarity^o): each coarser level drops the finest remaining octave, which its spacing could
+// not resolve. Every level's points are points of level 0 and every octave a level needs is one level 0 needs too,
+// so generate() evaluates each octave once over level 0 and takes the coarser levels from the running sum as it
+// passes their octave count. The levels are exactly those generated one at a time, for a fraction of the cost.
+template<typename _Noise>
+class FractalPyramid
+{
+	static_assert(_Noise::Dimensions == 2, "FractalPyramid builds 2D terrain levels");
+
+  public:
+	typedef typename _Noise::float_type float_type;
+
+  private:
+	const _Noise& noise;
+	size_t side;
+	uint32_t levelCount, octaveCount;
+	double x0, y0, step, lacunarity, gain;
+
+	// Octave o of a levelSide * levelSide grid spaced by levelStep, before its amplitude, into out.
+	void octave(uint32_t o, size_t levelSide, double levelStep, float_type* out) const
+	{
+		double frequency = std::pow(lacunarity, double(o));
+		noise.generate(
+		      out,
+		      { levelSide, levelSide },
+		      { float_type(x0 * frequency), float_type(y0 * frequency) },
+		      float_type(levelStep * frequency));
+	}
+
+	float_type amplitude(uint32_t o) const
+	{
+		float_type a = 1;
+		for (uint32_t k = 0; k < o; ++k)
+		{
+			a *= float_type(gain);
+		}
+		return a;
+	}
+
+  public:
+	// Level 0 is side * side samples; side = 2^k + 1 keeps the region's far edge on every level.
+	FractalPyramid(
+	      const _Noise& noise,
+	      size_t side,
+	      uint32_t levels,
+	      uint32_t octaves,
+	      double x0,
+	      double y0,
+	      double step,
+	      double lacunarity = 2,
+	      double gain = 0.5)
+	    : noise(noise)
+	    , side(side)
+	    , levelCount(std::max(levels, 1u))
+	    , octaveCount(std::max(octaves, 1u))
+	    , x0(x0)
+	    , y0(y0)
+	    , step(step)
+	    , lacunarity(lacunarity)
+	    , gain(gain)
+	{
+	}
+
+	uint32_t levels() const { return levelCount; }
+	uint32_t octaves(uint32_t level) const { return octaveCount > level ? octaveCount - level : 1; }
+	size_t level_side(uint32_t level) const { return side == 0 ? 0 : ((side - 1) >> level) + 1; }
+
+	// Every level, finest first.
+	std::vector<std::vector<float_type>> generate() const
+	{
+		std::vector<std::vector<float_type>> out(levelCount);
+		std::vector<float_type> sum(side * side, float_type(0)), layer(side * side);
+		for (uint32_t o = 0; o < octaveCount; ++o)
+		{
+			octave(o, side, step, layer.data());
+			float_type a = amplitude(o);
+			for (size_t n = 0; n < sum.size(); ++n)
+			{
+				sum[n] += a * layer[n];
+			}
+
+			for (uint32_t l = 1; l < levelCount; ++l)
+			{
+				if (octaves(l) != o + 1)
+				{
+					continue;
+				}
+				size_t levelSide = level_side(l), stride = size_t(1) << l;
+				out[l].resize(levelSide * levelSide);
+				for (size_t j = 0; j < levelSide; ++j)
+				{
+					for (size_t i = 0; i < levelSide; ++i)
+					{
+						out[l][j * levelSide + i] = sum[(j * stride) * side + i * stride];
+					}
+				}
+			}
+		}
+		out[0] = std::move(sum);
+		return out;
+	}
+
+	// One level on its own, evaluating all of its octaves at its own resolution.
+	std::vector<float_type> generate_level(uint32_t level) const
+	{
+		size_t levelSide = level_side(level);
+		double levelStep = step * double(size_t(1) << level);
+		std::vector<float_type> sum(levelSide * levelSide, float_type(0)), layer(levelSide * levelSide);
+		for (uint32_t o = 0; o < octaves(level); ++o)
+		{
+			octave(o, levelSide, levelStep, layer.data());
+			float_type a = amplitude(o);
+			for (size_t n = 0; n < sum.size(); ++n)
+			{
+				sum[n] += a * layer[n];
+			}
+		}
+		return sum;
+	}
+};
+
+} // namespace osn
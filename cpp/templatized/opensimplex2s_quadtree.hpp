@@ -0,0 +1,231 @@
+#pragma once
+
+#include "opensimplex2s.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+namespace osn
+{
+
+// Adaptive 2D sampling for terrain LOD. A quadtree over the square [x0, x0 + extent] * [y0, y0 + extent] is refined
+// only where a leaf interpolated from its corners could be off by more than the tolerance. The error of bilinear
+// interpolation over a cell of side h, and of linear interpolation over its halves, is at most h^2 / 4 times the
+// largest Hessian norm of the noise over the cell, which the curvature bound provides locally.
+// The tree is balanced so that neighbouring leaves differ by at most one level; a leaf next to finer ones gets a
+// center sample, which triangles() fans around so that the mesh has no cracks.
+template<typename _Noise>
+class QuadtreeSampler
+{
+	static_assert(_Noise::Dimensions == 2, "QuadtreeSampler samples 2D terrain");
+
+  public:
+	typedef typename _Noise::float_type float_type;
+
+	static constexpr uint32_t NoSample = ~uint32_t(0);
+
+	struct Sample
+	{
+		float_type x, y, value;
+	};
+
+	// A leaf spans [x, x + size] * [y, y + size] in units of step(). Corners run counterclockwise from (x, y),
+	// and midpoints[k] is the sample halfway along the edge from corners[k] to corners[k + 1], if a finer neighbour
+	// put one there.
+	struct Leaf
+	{
+		uint32_t x, y, size;
+		uint32_t corners[4];
+		uint32_t midpoints[4];
+		uint32_t center;
+	};
+
+  private:
+	const _Noise& noise;
+	double x0, y0, extent;
+	uint32_t maxLevel;
+	std::vector<Sample> sampleList;
+	std::vector<Leaf> leafList;
+	std::unordered_map<uint64_t, uint32_t> sampleIndex;
+
+	static uint64_t key(uint32_t level, uint32_t x, uint32_t y) { return (uint64_t(level) << 58) | (uint64_t(x) << 29) | y; }
+
+	uint32_t find_sample(uint32_t x, uint32_t y) const
+	{
+		auto it = sampleIndex.find((uint64_t(x) << 32) | y);
+		return it == sampleIndex.end() ? NoSample : it->second;
+	}
+
+	uint32_t add_sample(uint32_t x, uint32_t y)
+	{
+		auto inserted = sampleIndex.emplace((uint64_t(x) << 32) | y, uint32_t(sampleList.size()));
+		if (inserted.second)
+		{
+			float_type px = float_type(x0 + x * step()), py = float_type(y0 + y * step());
+			sampleList.push_back({ px, py, noise(px, py) });
+		}
+		return inserted.first->second;
+	}
+
+	void build(double tolerance)
+	{
+		const uint32_t cells = 1u << maxLevel;
+
+		// Refine top-down until the curvature bound meets the tolerance.
+		std::unordered_set<uint64_t> leafSet, splitSet;
+		std::vector<std::array<uint32_t, 3>> stack{ { 0, 0, 0 } };
+		while (!stack.empty())
+		{
+			std::array<uint32_t, 3> node = stack.back();
+			stack.pop_back();
+			uint32_t level = node[0], size = cells >> level;
+			double h = size * step();
+			std::array<float_type, 2> lo{ float_type(x0 + node[1] * size * step()), float_type(y0 + node[2] * size * step()) };
+			std::array<float_type, 2> hi{ float_type(lo[0] + h), float_type(lo[1] + h) };
+			if (level == maxLevel || h * h / 4 * noise.curvature(lo, hi) <= tolerance)
+			{
+				leafSet.insert(key(level, node[1], node[2]));
+				continue;
+			}
+			splitSet.insert(key(level, node[1], node[2]));
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				stack.push_back({ level + 1, node[1] * 2 + (c & 1), node[2] * 2 + (c >> 1) });
+			}
+		}
+
+		// Balance: a leaf whose edge neighbour is a coarser leaf more than one level up splits that neighbour.
+		std::vector<uint64_t> queue(leafSet.begin(), leafSet.end());
+		while (!queue.empty())
+		{
+			uint64_t k = queue.back();
+			queue.pop_back();
+			uint32_t level = uint32_t(k >> 58), x = uint32_t(k >> 29) & 0x1FFFFFFF, y = uint32_t(k) & 0x1FFFFFFF;
+			if (level < 2 || leafSet.count(k) == 0)
+			{
+				continue;
+			}
+
+			static constexpr int32_t dx[4] = { 0, 1, 0, -1 }, dy[4] = { -1, 0, 1, 0 };
+			for (uint32_t edge = 0; edge < 4; ++edge)
+			{
+				int64_t nx = int64_t(x) + dx[edge], ny = int64_t(y) + dy[edge];
+				if (nx < 0 || ny < 0 || nx >= (int64_t(1) << level) || ny >= (int64_t(1) << level))
+				{
+					continue;
+				}
+				nx >>= 1;
+				ny >>= 1;
+				if (leafSet.count(key(level - 1, uint32_t(nx), uint32_t(ny))) != 0
+				    || splitSet.count(key(level - 1, uint32_t(nx), uint32_t(ny))) != 0)
+				{
+					continue;
+				}
+
+				// Split the coarser leaf covering the neighbour's parent-level cell until that cell is reached.
+				for (uint32_t m = 0; m + 1 < level; ++m)
+				{
+					uint32_t shift = level - 1 - m;
+					uint64_t coarse = key(m, uint32_t(nx >> shift), uint32_t(ny >> shift));
+					if (leafSet.erase(coarse) == 0)
+					{
+						continue;
+					}
+					splitSet.insert(coarse);
+					for (uint32_t c = 0; c < 4; ++c)
+					{
+						uint64_t child = key(m + 1, uint32_t(nx >> shift) * 2 + (c & 1), uint32_t(ny >> shift) * 2 + (c >> 1));
+						leafSet.insert(child);
+						queue.push_back(child);
+					}
+				}
+			}
+		}
+
+		// Corners first, so that midpoints only find samples put there by finer neighbours.
+		leafList.reserve(leafSet.size());
+		for (uint64_t k : leafSet)
+		{
+			uint32_t level = uint32_t(k >> 58), size = cells >> level;
+			uint32_t x = (uint32_t(k >> 29) & 0x1FFFFFFF) * size, y = (uint32_t(k) & 0x1FFFFFFF) * size;
+			Leaf leaf{ x, y, size, {}, {}, NoSample };
+			leaf.corners[0] = add_sample(x, y);
+			leaf.corners[1] = add_sample(x + size, y);
+			leaf.corners[2] = add_sample(x + size, y + size);
+			leaf.corners[3] = add_sample(x, y + size);
+			leafList.push_back(leaf);
+		}
+		for (Leaf& leaf : leafList)
+		{
+			uint32_t half = leaf.size / 2;
+			leaf.midpoints[0] = half ? find_sample(leaf.x + half, leaf.y) : NoSample;
+			leaf.midpoints[1] = half ? find_sample(leaf.x + leaf.size, leaf.y + half) : NoSample;
+			leaf.midpoints[2] = half ? find_sample(leaf.x + half, leaf.y + leaf.size) : NoSample;
+			leaf.midpoints[3] = half ? find_sample(leaf.x, leaf.y + half) : NoSample;
+		}
+		for (Leaf& leaf : leafList)
+		{
+			for (uint32_t midpoint : leaf.midpoints)
+			{
+				if (midpoint != NoSample)
+				{
+					leaf.center = add_sample(leaf.x + leaf.size / 2, leaf.y + leaf.size / 2);
+					break;
+				}
+			}
+		}
+	}
+
+  public:
+	// The finest cells are extent / 2^maxLevel wide.
+	QuadtreeSampler(const _Noise& noise, double x0, double y0, double extent, double tolerance, uint32_t maxLevel = 10)
+	    : noise(noise)
+	    , x0(x0)
+	    , y0(y0)
+	    , extent(extent)
+	    , maxLevel(std::min(maxLevel, 28u))
+	{
+		build(tolerance);
+	}
+
+	double step() const { return extent / double(1u << maxLevel); }
+	const std::vector<Sample>& samples() const { return sampleList; }
+	const std::vector<Leaf>& leaves() const { return leafList; }
+
+	// Counterclockwise index triples into samples(). Leaves without a center sample split along a diagonal;
+	// the others fan around their center through every corner and midpoint.
+	std::vector<uint32_t> triangles() const
+	{
+		std::vector<uint32_t> indices;
+		indices.reserve(leafList.size() * 6);
+		for (const Leaf& leaf : leafList)
+		{
+			if (leaf.center == NoSample)
+			{
+				indices.insert(indices.end(), { leaf.corners[0], leaf.corners[1], leaf.corners[2] });
+				indices.insert(indices.end(), { leaf.corners[0], leaf.corners[2], leaf.corners[3] });
+				continue;
+			}
+
+			uint32_t ring[8], n = 0;
+			for (uint32_t k = 0; k < 4; ++k)
+			{
+				ring[n++] = leaf.corners[k];
+				if (leaf.midpoints[k] != NoSample)
+				{
+					ring[n++] = leaf.midpoints[k];
+				}
+			}
+			for (uint32_t i = 0; i < n; ++i)
+			{
+				indices.insert(indices.end(), { leaf.center, ring[i], ring[(i + 1) % n] });
+			}
+		}
+		return indices;
+	}
+};
+
+
+} // namespace osn
@@ -0,0 +1,907 @@
+#pragma once
+
+#include "opensimplex2s.hpp"
+#include "opensimplex2s_any.hpp"
+#include "opensimplex2s_cache.hpp"
+#include "opensimplex2s_shared_cache.hpp"
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+namespace osn
+{
+
+// A box of tiles of fractal noise, each tileSize samples on every axis spaced by frequency, so that sample i of tile
+// t lies at (t * tileSize + i) * frequency as in ChunkCache::get(). Each sample sums octaves of
+// gain^o * noise(p * lacunarity^o). Tiles first to last are requested inclusively on the mode's axes; the others
+// must be 0.
+struct TileRequest
+{
+	static constexpr uint64_t MaxTiles = 4096;
+	// The farthest a sample of any octave may lie from the origin, past which float samples are no longer distinct.
+	static constexpr double MaxCoordinate = 16777216;
+
+	uint64_t seed = 0;
+	// seed_type_of() the seed's type, whose shuffle the server uses; set_seed() fills in both.
+	uint32_t seedType = seed_type_of<uint64_t>();
+	Mode mode = Mode::Standard_2D;
+	uint32_t tileSize = 0;
+	double frequency = 0;
+	uint32_t octaves = 1;
+	double lacunarity = 2;
+	double gain = 0.5;
+	std::array<int64_t, 4> first{}, last{};
+
+	template<typename _SeedT>
+	void set_seed(_SeedT s)
+	{
+		seed = uint64_t(s);
+		seedType = seed_type_of<_SeedT>();
+	}
+
+	// The number of tiles, or MaxTiles + 1 for any more than MaxTiles.
+	uint64_t tile_count() const
+	{
+		uint64_t count = 1;
+		for (uint32_t k = 0; k < 4; ++k)
+		{
+			// One less than the extent, which for the whole int64_t range does not fit.
+			uint64_t span = uint64_t(last[k]) - uint64_t(first[k]);
+			uint64_t extent = last[k] < first[k] ? 0 : std::min(span, MaxTiles) + 1;
+			count = std::min(count * extent, MaxTiles + 1);
+		}
+		return count;
+	}
+
+	// The tiles in order, x varying fastest. Counts them rather than stepping past last, which may be INT64_MAX.
+	std::vector<std::array<int64_t, 4>> tiles() const
+	{
+		std::vector<std::array<int64_t, 4>> out;
+		uint64_t count = tile_count();
+		if (count > MaxTiles)
+		{
+			throw std::invalid_argument("A tile request may name at most TileRequest::MaxTiles tiles");
+		}
+		std::array<uint64_t, 4> extent;
+		for (uint32_t k = 0; k < 4; ++k)
+		{
+			extent[k] = uint64_t(last[k]) - uint64_t(first[k]) + 1;
+		}
+		out.reserve(size_t(count));
+		for (uint64_t n = 0; n < count; ++n)
+		{
+			std::array<int64_t, 4> t;
+			for (uint64_t k = 0, rest = n; k < 4; rest /= extent[k], ++k)
+			{
+				t[k] = int64_t(uint64_t(first[k]) + rest % extent[k]);
+			}
+			out.push_back(t);
+		}
+		return out;
+	}
+
+	ChunkKey key(const std::array<int64_t, 4>& tile) const
+	{
+		ChunkKey k;
+		k.seed = seed;
+		k.seedType = seedType;
+		k.mode = mode;
+		k.dimensions = mode_dimensions(mode);
+		k.set_default_kernel();
+		k.chunk = tile;
+		k.frequency = frequency;
+		k.chunkSize = tileSize;
+		k.octaves = octaves;
+		k.lacunarity = lacunarity;
+		k.gain = gain;
+		return k;
+	}
+};
+
+enum class TileStatus : uint32_t
+{
+	Ok,
+	BadRequest,       // An unknown mode, seed type or seed, no octaves, an empty box, a non-finite parameter, or a
+	                  // sample too far out.
+	TooLarge,         // More than MaxTiles tiles, or a tile larger than the cache's slots.
+	GenerationFailed  // Generating a tile threw; the request is not worth retrying.
+};
+
+struct TileServerStats
+{
+	uint64_t requests = 0;
+	uint64_t batches = 0;
+	uint64_t tiles = 0;     // Requested, over all requests.
+	uint64_t coalesced = 0; // Requested by more than one request of a batch and served once.
+	uint64_t generated = 0; // Not found in the shared cache.
+};
+
+namespace _detail
+{
+	constexpr uint32_t TileProtocolMagic = 0x4E534F54; // "TOSN"
+	constexpr uint32_t TileProtocolVersion = 2;
+
+	struct tile_request_message
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t id;
+		TileRequest request;
+	};
+
+	// Followed by count SharedChunkHandles, one per tile of the request in order.
+	struct tile_reply_header
+	{
+		uint64_t id;
+		TileStatus status;
+		uint32_t count;
+	};
+
+	inline sockaddr_un unix_address(const std::string& path)
+	{
+		sockaddr_un address;
+		std::memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path))
+		{
+			throw std::invalid_argument("Socket path " + path + " is too long");
+		}
+		std::memcpy(address.sun_path, path.c_str(), path.size());
+		return address;
+	}
+
+	inline bool send_all(int fd, const void* data, size_t length)
+	{
+		const uint8_t* p = static_cast<const uint8_t*>(data);
+		while (length > 0)
+		{
+			ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (n <= 0)
+			{
+				return false;
+			}
+			p += n;
+			length -= size_t(n);
+		}
+		return true;
+	}
+
+	inline bool receive_all(int fd, void* data, size_t length)
+	{
+		uint8_t* p = static_cast<uint8_t*>(data);
+		while (length > 0)
+		{
+			ssize_t n = recv(fd, p, length, 0);
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (n <= 0)
+			{
+				return false;
+			}
+			p += n;
+			length -= size_t(n);
+		}
+		return true;
+	}
+
+} // namespace _detail
+
+// Local daemon serving TileRequests over a Unix domain socket, so that tools and jobs on one host share one set of
+// warm tables and one shared chunk cache instead of each generating its own tiles.
+//
+// Requests are batched the way a log commits groups: every request that arrived while the previous batch was being
+// served is served in the next one. A tile requested several times in a batch is generated once, tiles already in
+// the cache are not generated at all, and the rest are spread over threadCount threads. Tiles are generated into the
+// shared cache and the reply carries only their handles, which the client opens in place.
+//
+// Client sockets are non-blocking: replies are queued per connection and sent as the client reads them, so a client
+// that stops reading holds up no one else. Its requests are not read while it has replies queued.
+template<typename _Float = float>
+class TileServer
+{
+	struct Connection
+	{
+		int fd;
+		std::vector<uint8_t> buffer;
+		std::vector<uint8_t> output;
+	};
+
+	struct Pending
+	{
+		int fd;
+		_detail::tile_request_message message;
+	};
+
+	SharedChunkCache<_Float> cache;
+	std::string path;
+	int listener = -1;
+	int wake[2] = { -1, -1 };
+	size_t threadCount, slotValues;
+	std::atomic<bool> stopping{ false };
+	std::vector<Connection> connections;
+	// Warm noise per seed, seed type and mode; modes of one dimension share their seed's tables.
+	std::map<std::tuple<uint64_t, uint32_t, Mode>, AnyOpenSimplex2S<_Float>> noises;
+
+	std::atomic<uint64_t> requests{ 0 }, batches{ 0 }, tiles{ 0 }, coalesced{ 0 }, generated{ 0 };
+
+	// Calls fn with the seed converted back to the fixed-width type seedType tags. Returns false for any other tag.
+	template<typename _Fn>
+	static bool with_seed(uint64_t seed, uint32_t seedType, _Fn&& fn)
+	{
+		switch (seedType)
+		{
+		case seed_type_of<int8_t>():
+			fn(int8_t(seed));
+			break;
+		case seed_type_of<uint8_t>():
+			fn(uint8_t(seed));
+			break;
+		case seed_type_of<int16_t>():
+			fn(int16_t(seed));
+			break;
+		case seed_type_of<uint16_t>():
+			fn(uint16_t(seed));
+			break;
+		case seed_type_of<int32_t>():
+			fn(int32_t(seed));
+			break;
+		case seed_type_of<uint32_t>():
+			fn(uint32_t(seed));
+			break;
+		case seed_type_of<int64_t>():
+			fn(int64_t(seed));
+			break;
+		case seed_type_of<uint64_t>():
+			fn(seed);
+			break;
+		default:
+			return false;
+		}
+		return true;
+	}
+
+	// Whether the seed has a known type and is the value set_seed() gives for it, so that one noise has one key.
+	static bool canonical_seed(const TileRequest& r)
+	{
+		bool canonical = false;
+		with_seed(r.seed, r.seedType, [&](auto seed) { canonical = uint64_t(seed) == r.seed; });
+		return canonical;
+	}
+
+	const AnyOpenSimplex2S<_Float>& noise_for(const TileRequest& r)
+	{
+		std::tuple<uint64_t, uint32_t, Mode> key(r.seed, r.seedType, r.mode);
+		auto it = noises.find(key);
+		if (it != noises.end())
+		{
+			return it->second;
+		}
+		for (auto& other : noises)
+		{
+			if (std::get<0>(other.first) == r.seed && std::get<1>(other.first) == r.seedType
+			    && other.second.dimensions() == mode_dimensions(r.mode))
+			{
+				return noises.emplace(key, other.second.with_mode(r.mode)).first->second;
+			}
+		}
+		const AnyOpenSimplex2S<_Float>* noise = nullptr;
+		with_seed(r.seed, r.seedType, [&](auto seed) {
+			noise = &noises.emplace(key, AnyOpenSimplex2S<_Float>(r.mode, seed)).first->second;
+		});
+		return *noise;
+	}
+
+	TileStatus validate(const TileRequest& r) const
+	{
+		if (uint32_t(r.mode) > uint32_t(Mode::XYZBeforeW_4D) || r.octaves == 0 || r.octaves > 32 || r.tileSize == 0
+		      || !std::isfinite(r.frequency) || !std::isfinite(r.lacunarity) || !std::isfinite(r.gain)
+		      || !canonical_seed(r))
+		{
+			return TileStatus::BadRequest;
+		}
+		uint32_t dimensions = mode_dimensions(r.mode);
+		// The largest a sample coordinate gets over the octaves, per tile of distance from the origin.
+		double reach = double(r.tileSize) * std::abs(r.frequency)
+		      * std::max(1.0, std::pow(std::abs(r.lacunarity), double(r.octaves - 1)));
+		uint64_t values = 1;
+		for (uint32_t k = 0; k < 4; ++k)
+		{
+			if (r.last[k] < r.first[k] || (k >= dimensions && (r.first[k] != 0 || r.last[k] != 0)))
+			{
+				return TileStatus::BadRequest;
+			}
+			if (k < dimensions)
+			{
+				double tiles = std::max(std::abs(double(r.first[k])), std::abs(double(r.last[k]) + 1));
+				if (!(tiles * reach <= TileRequest::MaxCoordinate))
+				{
+					return TileStatus::BadRequest;
+				}
+				values = std::min(values * r.tileSize, uint64_t(slotValues) + 1);
+			}
+		}
+		return r.tile_count() > TileRequest::MaxTiles || values > slotValues ? TileStatus::TooLarge : TileStatus::Ok;
+	}
+
+	// The fractal sum for key into out, using layer for the octaves after the first.
+	static void generate(
+	      const AnyOpenSimplex2S<_Float>& noise,
+	      const ChunkKey& key,
+	      _Float* out,
+	      std::vector<_Float>& layer)
+	{
+		size_t side = size_t(key.chunkSize), count = 1;
+		for (uint32_t k = 0; k < key.dimensions; ++k)
+		{
+			count *= side;
+		}
+		layer.resize(count);
+		_Float amplitude = 1;
+		for (uint32_t o = 0; o < key.octaves; ++o)
+		{
+			double frequency = std::pow(key.lacunarity, double(o));
+			std::array<_Float, 4> origin;
+			for (uint32_t k = 0; k < 4; ++k)
+			{
+				origin[k] = _Float(double(key.chunk[k]) * double(side) * key.frequency * frequency);
+			}
+			_Float step = _Float(key.frequency * frequency);
+			_Float* target = o == 0 ? out : layer.data();
+			switch (key.dimensions)
+			{
+			case 2:
+				noise.generate(target, { side, side }, { origin[0], origin[1] }, step);
+				break;
+			case 3:
+				noise.generate(target, { side, side, side }, { origin[0], origin[1], origin[2] }, step);
+				break;
+			default:
+				noise.generate(target, { side, side, side, side }, { origin[0], origin[1], origin[2], origin[3] }, step);
+				break;
+			}
+			if (o > 0)
+			{
+				for (size_t n = 0; n < count; ++n)
+				{
+					out[n] += amplitude * layer[n];
+				}
+			}
+			amplitude *= _Float(key.gain);
+		}
+	}
+
+	// Generates or finds every distinct tile of the batch, then answers each request. The tiles stay pinned until
+	// every reply is queued; a handle whose tile is evicted before the client reads its reply fails to open, and the
+	// client asks for the tile again.
+	void serve(std::vector<Pending>& batch)
+	{
+		struct Job
+		{
+			ChunkKey key;
+			const AnyOpenSimplex2S<_Float>* noise;
+			typename SharedChunkCache<_Float>::ChunkView view;
+			bool failed;
+		};
+		std::vector<Job> jobs;
+		std::unordered_map<ChunkKey, size_t, ChunkKeyHash> index;
+		std::vector<std::vector<size_t>> replies(batch.size());
+		std::vector<TileStatus> statuses(batch.size());
+		uint64_t requested = 0;
+		for (size_t r = 0; r < batch.size(); ++r)
+		{
+			const TileRequest& request = batch[r].message.request;
+			statuses[r] = validate(request);
+			if (statuses[r] != TileStatus::Ok)
+			{
+				continue;
+			}
+			const AnyOpenSimplex2S<_Float>& noise = noise_for(request);
+			for (const std::array<int64_t, 4>& tile : request.tiles())
+			{
+				ChunkKey key = request.key(tile);
+				auto it = index.emplace(key, jobs.size()).first;
+				if (it->second == jobs.size())
+				{
+					jobs.push_back(Job{ key, &noise, {}, false });
+				}
+				replies[r].push_back(it->second);
+				++requested;
+			}
+		}
+
+		std::atomic<size_t> next{ 0 };
+		auto work = [&]() {
+			std::vector<_Float> layer;
+			for (size_t j; (j = next.fetch_add(1)) < jobs.size();)
+			{
+				Job& job = jobs[j];
+				size_t count = 1;
+				for (uint32_t k = 0; k < job.key.dimensions; ++k)
+				{
+					count *= size_t(job.key.chunkSize);
+				}
+				try
+				{
+					job.view = cache.get(job.key, count, [&](_Float* out) {
+						generated.fetch_add(1, std::memory_order_relaxed);
+						generate(*job.noise, job.key, out, layer);
+					});
+				}
+				catch (...)
+				{
+					job.failed = true;
+				}
+			}
+		};
+		std::vector<std::thread> workers;
+		for (size_t t = 1; t < std::min(threadCount, jobs.size()); ++t)
+		{
+			workers.emplace_back(work);
+		}
+		work();
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		requests.fetch_add(batch.size(), std::memory_order_relaxed);
+		batches.fetch_add(1, std::memory_order_relaxed);
+		tiles.fetch_add(requested, std::memory_order_relaxed);
+		coalesced.fetch_add(requested - jobs.size(), std::memory_order_relaxed);
+
+		std::vector<uint8_t> reply;
+		for (size_t r = 0; r < batch.size(); ++r)
+		{
+			if (std::any_of(replies[r].begin(), replies[r].end(), [&](size_t j) { return jobs[j].failed; }))
+			{
+				statuses[r] = TileStatus::GenerationFailed;
+				replies[r].clear();
+			}
+			_detail::tile_reply_header header{ batch[r].message.id, statuses[r], uint32_t(replies[r].size()) };
+			reply.resize(sizeof(header) + replies[r].size() * sizeof(SharedChunkHandle));
+			std::memcpy(reply.data(), &header, sizeof(header));
+			// A tile held by its view alone, its bucket being pinned full, has an empty handle and is asked for again.
+			for (size_t n = 0; n < replies[r].size(); ++n)
+			{
+				SharedChunkHandle handle = jobs[replies[r][n]].view.handle();
+				std::memcpy(reply.data() + sizeof(header) + n * sizeof(SharedChunkHandle), &handle, sizeof(handle));
+			}
+			Connection* c = connection(batch[r].fd);
+			if (c)
+			{
+				c->output.insert(c->output.end(), reply.begin(), reply.end());
+				if (!flush(*c) || c->output.size() > MaxQueuedBytes)
+				{
+					close_connection(c->fd);
+				}
+			}
+		}
+	}
+
+	Connection* connection(int fd)
+	{
+		for (Connection& c : connections)
+		{
+			if (c.fd == fd)
+			{
+				return &c;
+			}
+		}
+		return nullptr;
+	}
+
+	// Sends as much of c's queued replies as the socket takes. Returns false once the client has gone.
+	bool flush(Connection& c)
+	{
+		size_t sent = 0;
+		while (sent < c.output.size())
+		{
+			ssize_t n = send(c.fd, c.output.data() + sent, c.output.size() - sent, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				break;
+			}
+			if (n <= 0)
+			{
+				return false;
+			}
+			sent += size_t(n);
+		}
+		c.output.erase(c.output.begin(), c.output.begin() + std::ptrdiff_t(sent));
+		return true;
+	}
+
+	void close_connection(int fd)
+	{
+		for (auto it = connections.begin(); it != connections.end(); ++it)
+		{
+			if (it->fd == fd)
+			{
+				::close(fd);
+				connections.erase(it);
+				return;
+			}
+		}
+	}
+
+	// Reads what connection c has sent into batch. Returns false once the client has gone.
+	bool receive(Connection& c, std::vector<Pending>& batch)
+	{
+		uint8_t data[4096];
+		for (;;)
+		{
+			ssize_t n = recv(c.fd, data, sizeof(data), MSG_DONTWAIT);
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				break;
+			}
+			if (n <= 0)
+			{
+				return false;
+			}
+			c.buffer.insert(c.buffer.end(), data, data + n);
+		}
+
+		size_t used = 0;
+		for (; c.buffer.size() - used >= sizeof(_detail::tile_request_message);
+		     used += sizeof(_detail::tile_request_message))
+		{
+			Pending p;
+			p.fd = c.fd;
+			std::memcpy(&p.message, c.buffer.data() + used, sizeof(p.message));
+			if (p.message.magic != _detail::TileProtocolMagic || p.message.version != _detail::TileProtocolVersion)
+			{
+				return false;
+			}
+			batch.push_back(p);
+		}
+		c.buffer.erase(c.buffer.begin(), c.buffer.begin() + std::ptrdiff_t(used));
+		return true;
+	}
+
+  public:
+	// Replies a connection may have queued, past which its client is taken to have stalled and is dropped.
+	static constexpr size_t MaxQueuedBytes = size_t(16) << 20;
+
+	// Listens on socketPath, replacing a stale socket file, and creates or opens the shared chunk cache cacheName,
+	// which clients must open with the same slotCount and slotValues.
+	TileServer(
+	      const std::string& socketPath,
+	      const std::string& cacheName,
+	      size_t slotCount,
+	      size_t slotValues,
+	      size_t threadCount = std::thread::hardware_concurrency())
+	    : cache(cacheName, slotCount, slotValues)
+	    , path(socketPath)
+	    , threadCount(std::max(threadCount, size_t(1)))
+	    , slotValues(slotValues)
+	{
+		sockaddr_un address = _detail::unix_address(path);
+		listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener < 0 || pipe(wake) != 0)
+		{
+			throw std::runtime_error("Cannot create the tile service socket");
+		}
+		unlink(path.c_str());
+		if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 64) != 0)
+		{
+			int error = errno;
+			::close(listener);
+			::close(wake[0]);
+			::close(wake[1]);
+			throw std::runtime_error("Cannot listen on " + path + ": " + std::strerror(error));
+		}
+	}
+
+	TileServer(const TileServer&) = delete;
+	TileServer& operator=(const TileServer&) = delete;
+
+	~TileServer()
+	{
+		for (Connection& c : connections)
+		{
+			::close(c.fd);
+		}
+		::close(listener);
+		::close(wake[0]);
+		::close(wake[1]);
+		unlink(path.c_str());
+	}
+
+	// Serves requests until stop() is called.
+	void run()
+	{
+		std::vector<pollfd> fds;
+		std::vector<Pending> batch;
+		while (!stopping.load())
+		{
+			fds.clear();
+			fds.push_back(pollfd{ wake[0], POLLIN, 0 });
+			fds.push_back(pollfd{ listener, POLLIN, 0 });
+			for (const Connection& c : connections)
+			{
+				fds.push_back(pollfd{ c.fd, short(c.output.empty() ? POLLIN : POLLOUT), 0 });
+			}
+			// Waits for the first request of a batch; the others are whatever has arrived by then.
+			if (poll(fds.data(), nfds_t(fds.size()), -1) < 0)
+			{
+				continue;
+			}
+			if (fds[1].revents & POLLIN)
+			{
+				int fd = accept(listener, nullptr, nullptr);
+				if (fd >= 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0)
+				{
+					connections.push_back(Connection{ fd, {}, {} });
+				}
+				else if (fd >= 0)
+				{
+					::close(fd);
+				}
+			}
+
+			std::vector<int> gone;
+			for (size_t n = 2; n < fds.size(); ++n)
+			{
+				if (fds[n].revents == 0)
+				{
+					continue;
+				}
+				Connection* c = connection(fds[n].fd);
+				if (c && !(c->output.empty() ? receive(*c, batch) : flush(*c)))
+				{
+					gone.push_back(c->fd);
+				}
+			}
+			for (int fd : gone)
+			{
+				batch.erase(
+				      std::remove_if(batch.begin(), batch.end(), [&](const Pending& p) { return p.fd == fd; }),
+				      batch.end());
+				close_connection(fd);
+			}
+
+			if (!batch.empty())
+			{
+				serve(batch);
+				batch.clear();
+			}
+		}
+	}
+
+	// Makes run() return, from any thread.
+	void stop()
+	{
+		stopping.store(true);
+		char byte = 0;
+		ssize_t written = write(wake[1], &byte, 1);
+		(void)written;
+	}
+
+	TileServerStats stats() const
+	{
+		TileServerStats s;
+		s.requests = requests.load(std::memory_order_relaxed);
+		s.batches = batches.load(std::memory_order_relaxed);
+		s.tiles = tiles.load(std::memory_order_relaxed);
+		s.coalesced = coalesced.load(std::memory_order_relaxed);
+		s.generated = generated.load(std::memory_order_relaxed);
+		return s;
+	}
+};
+
+// Connection to a TileServer, for one thread at a time. Tiles are read in place from the shared chunk cache, which
+// the caller opens with the server's parameters; those already cached are read without asking the server at all.
+template<typename _Float = float>
+class TileClient
+{
+	SharedChunkCache<_Float>& cache;
+	int fd = -1;
+	uint64_t nextId = 0;
+	uint64_t roundTrips = 0;
+
+  public:
+	typedef typename SharedChunkCache<_Float>::ChunkView ChunkView;
+
+	// Tries for a tile that keeps being evicted between the server's reply and its opening.
+	static constexpr uint32_t MaxAttempts = 8;
+
+	TileClient(const std::string& socketPath, SharedChunkCache<_Float>& cache)
+	    : cache(cache)
+	{
+		sockaddr_un address = _detail::unix_address(socketPath);
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+		{
+			int error = errno;
+			if (fd >= 0)
+			{
+				::close(fd);
+			}
+			throw std::runtime_error("Cannot connect to the tile service at " + socketPath + ": " + std::strerror(error));
+		}
+	}
+
+	TileClient(const TileClient&) = delete;
+	TileClient& operator=(const TileClient&) = delete;
+
+	~TileClient() { ::close(fd); }
+
+	// The request's tiles in order, x varying fastest.
+	std::vector<ChunkView> fetch(const TileRequest& request)
+	{
+		std::vector<std::array<int64_t, 4>> tiles = request.tiles();
+		std::vector<ChunkView> views(tiles.size());
+		size_t missing = 0;
+		for (size_t n = 0; n < tiles.size(); ++n)
+		{
+			views[n] = cache.find(request.key(tiles[n]));
+			missing += !views[n];
+		}
+
+		for (uint32_t attempt = 0; missing > 0; ++attempt)
+		{
+			if (attempt == MaxAttempts)
+			{
+				throw std::runtime_error("Tiles were evicted before they could be read; the shared cache is too small");
+			}
+			_detail::tile_request_message message{
+				_detail::TileProtocolMagic, _detail::TileProtocolVersion, nextId++, request
+			};
+			_detail::tile_reply_header header;
+			if (!_detail::send_all(fd, &message, sizeof(message)) || !_detail::receive_all(fd, &header, sizeof(header)))
+			{
+				throw std::runtime_error("The tile service closed the connection");
+			}
+			std::vector<SharedChunkHandle> handles(header.count);
+			if (!_detail::receive_all(fd, handles.data(), handles.size() * sizeof(SharedChunkHandle)))
+			{
+				throw std::runtime_error("The tile service closed the connection");
+			}
+			++roundTrips;
+			if (header.status == TileStatus::GenerationFailed)
+			{
+				throw std::runtime_error("The tile service failed to generate the tiles");
+			}
+			if (header.status != TileStatus::Ok || header.count != tiles.size() || header.id != message.id)
+			{
+				throw std::invalid_argument("The tile service rejected the request");
+			}
+
+			missing = 0;
+			for (size_t n = 0; n < tiles.size(); ++n)
+			{
+				if (!views[n])
+				{
+					views[n] = cache.open(handles[n], request.key(tiles[n]));
+					missing += !views[n];
+				}
+			}
+		}
+		return views;
+	}
+
+	// Requests that needed the server.
+	uint64_t round_trips() const { return roundTrips; }
+};
+
+
+// Throughput and latency of a tile service under a number of clients each fetching requests back to back.
+struct TileLoadReport
+{
+	size_t clients = 0;
+	size_t requests = 0;
+	size_t tiles = 0;
+	size_t roundTrips = 0;
+	double seconds = 0;
+	std::vector<double> latencies; // Seconds per request, sorted.
+
+	double throughput() const { return seconds > 0 ? double(requests) / seconds : 0; }
+
+	double percentile(double p) const
+	{
+		if (latencies.empty())
+		{
+			return 0;
+		}
+		size_t n = std::min(size_t(p / 100 * double(latencies.size())), latencies.size() - 1);
+		return latencies[n];
+	}
+
+	void report(std::ostream& out) const
+	{
+		out << "Tile service, " << clients << " clients: " << requests << " requests (" << tiles << " tiles, "
+		    << roundTrips << " through the server) in " << seconds << " seconds, " << throughput()
+		    << " requests/s; latency p50 " << 1e6 * percentile(50) << " us, p99 " << 1e6 * percentile(99)
+		    << " us, p99.9 " << 1e6 * percentile(99.9) << " us, max " << 1e6 * percentile(100) << " us\n";
+	}
+};
+
+// Runs clients threads, each with its own connection, fetching requestsPerClient requests made by
+// makeRequest(std::mt19937_64&) from a generator seeded with the client's index.
+template<typename _Float, typename _MakeRequest>
+TileLoadReport run_tile_load(
+      const std::string& socketPath,
+      SharedChunkCache<_Float>& cache,
+      size_t clients,
+      size_t requestsPerClient,
+      _MakeRequest&& makeRequest)
+{
+	std::vector<std::vector<double>> latencies(clients);
+	std::vector<size_t> tiles(clients), roundTrips(clients);
+	std::vector<std::thread> threads;
+	std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+	for (size_t c = 0; c < clients; ++c)
+	{
+		threads.emplace_back([&, c]() {
+			TileClient<_Float> client(socketPath, cache);
+			std::mt19937_64 rng(c);
+			for (size_t r = 0; r < requestsPerClient; ++r)
+			{
+				TileRequest request = makeRequest(rng);
+				std::chrono::time_point<std::chrono::steady_clock> begin = std::chrono::steady_clock::now();
+				tiles[c] += client.fetch(request).size();
+				latencies[c].push_back(
+				      std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+			}
+			roundTrips[c] = size_t(client.round_trips());
+		});
+	}
+	for (std::thread& t : threads)
+	{
+		t.join();
+	}
+
+	TileLoadReport report;
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	report.clients = clients;
+	for (size_t c = 0; c < clients; ++c)
+	{
+		report.requests += latencies[c].size();
+		report.tiles += tiles[c];
+		report.roundTrips += roundTrips[c];
+		report.latencies.insert(report.latencies.end(), latencies[c].begin(), latencies[c].end());
+	}
+	std::sort(report.latencies.begin(), report.latencies.end());
+	return report;
+}
+
+} // namespace osn
+
+#endif
@@ -0,0 +1,672 @@
+#pragma once
+
+#include "opensimplex2s.hpp"
+#include "opensimplex2s_cache.hpp"
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace osn
+{
+
+struct SharedChunkCacheStats : ChunkCacheStats
+{
+	uint64_t recovered = 0;       // Clients found dead and released.
+	double generated_seconds = 0; // CPU time spent generating the chunks that were cached.
+	double saved_seconds = 0;     // CPU time the hits would have spent generating them again.
+};
+
+// Names a cached chunk to another process attached to the same segment, which can open() it while it is still there.
+struct SharedChunkHandle
+{
+	uint64_t slot = ~uint64_t(0);
+	uint64_t state = 0;
+};
+
+namespace _detail
+{
+	// Start of a shared chunk cache segment, followed by slotCount slots and then slotCount chunks of slotValues
+	// values. Everything is found by offset, so each process may map the segment at its own address.
+	struct shared_cache_header
+	{
+		static constexpr uint64_t Magic = 0x35454843414d534full; // "OSMACHE5"
+		static constexpr uint32_t MaxClients = 64;
+
+		std::atomic<uint64_t> magic;
+		uint32_t valueSize;
+		uint32_t slotCount;
+		uint64_t slotValues;
+		std::atomic<uint64_t> clock, hits, misses, evictions, bytes, recovered, generatedNs, savedNs;
+		std::atomic<int32_t> clients[MaxClients];
+	};
+
+	// The state word holds the state in bits 0-1, the client generating the chunk while Filling in bits 2-7, a
+	// generation bumped by every claim in bits 8-31 and a tag of the key's hash in bits 32-63, so that a reader can
+	// tell from one load whether the slot still holds what it saw, and a claim names its filler in the same store.
+	struct alignas(64) shared_cache_slot
+	{
+		static constexpr uint64_t Empty = 0, Filling = 1, Ready = 2;
+
+		std::atomic<uint64_t> state;
+		std::atomic<uint64_t> pinners; // One bit per client holding the chunk.
+		std::atomic<uint64_t> lastUse;
+		uint64_t count;
+		uint64_t costNs;
+		ChunkKey key;
+
+		static uint64_t word(uint64_t state, uint64_t generation, uint32_t tag, uint32_t filler = 0)
+		{
+			return state | uint64_t(filler & 0x3F) << 2 | (generation & 0xFFFFFF) << 8 | uint64_t(tag) << 32;
+		}
+		static uint64_t state_of(uint64_t word) { return word & 3; }
+		static uint32_t filler_of(uint64_t word) { return uint32_t(word >> 2) & 0x3F; }
+		static uint64_t generation_of(uint64_t word) { return (word >> 8) & 0xFFFFFF; }
+		static uint32_t tag_of(uint64_t word) { return uint32_t(word >> 32); }
+	};
+
+	static_assert(shared_cache_header::MaxClients == 64, "The state word has 6 bits for the filling client");
+
+	static_assert(
+	      std::atomic<uint64_t>::is_always_lock_free && std::atomic<int32_t>::is_always_lock_free,
+	      "Atomics shared between processes must be lock-free");
+
+} // namespace _detail
+
+// Cache of generated noise chunks in a POSIX shared-memory segment, shared by every process on the host that opens
+// it by name, so that generators of the same seeds compute each chunk once between them and read it in place.
+//
+// The segment is a fixed set of slots, Ways to a bucket, each holding one chunk of up to slotValues values. Lookups
+// take no lock: a chunk is pinned by setting the process's bit in its slot and then checking that the slot still
+// holds it, while eviction claims the least recently used slot of the bucket and backs off if any bit is set, so a
+// pinned chunk is never overwritten. A chunk being generated by one process is waited for by the others.
+//
+// Every process attached to the segment is listed in it by pid. Those found dead, whether by recover() or by a
+// waiter that has waited long, have their pins dropped and their unfinished chunks freed, so a crash loses at most
+// what the process was generating. A pid reused before the recovery keeps the dead process's pins until it exits.
+// Each process, including a fork() child, must open its own SharedChunkCache; ChunkViews must not outlive it.
+template<typename _Float = float>
+class SharedChunkCache
+{
+  public:
+	static constexpr uint32_t Ways = 8;
+
+	// A chunk read in place from the segment, pinned until the view is destroyed. Chunks that could not be cached,
+	// because every slot of their bucket was pinned, are held by the view itself.
+	class ChunkView
+	{
+		friend class SharedChunkCache;
+
+		SharedChunkCache* cache = nullptr;
+		size_t slot = 0;
+		const _Float* values = nullptr;
+		size_t count = 0;
+		std::vector<_Float> local;
+
+		ChunkView(SharedChunkCache* cache, size_t slot, const _Float* values, size_t count)
+		    : cache(cache)
+		    , slot(slot)
+		    , values(values)
+		    , count(count)
+		{
+		}
+
+		explicit ChunkView(std::vector<_Float>&& local)
+		    : values(local.data())
+		    , count(local.size())
+		    , local(std::move(local))
+		{
+		}
+
+	  public:
+		ChunkView() = default;
+		ChunkView(const ChunkView&) = delete;
+		ChunkView& operator=(const ChunkView&) = delete;
+		ChunkView(ChunkView&& o) noexcept { *this = std::move(o); }
+		ChunkView& operator=(ChunkView&& o) noexcept
+		{
+			std::swap(cache, o.cache);
+			std::swap(slot, o.slot);
+			std::swap(values, o.values);
+			std::swap(count, o.count);
+			std::swap(local, o.local);
+			return *this;
+		}
+		~ChunkView()
+		{
+			if (cache)
+			{
+				cache->unpin(slot);
+			}
+		}
+
+		explicit operator bool() const { return values != nullptr; }
+		bool shared() const { return cache != nullptr; }
+		SharedChunkHandle handle() const
+		{
+			SharedChunkHandle h;
+			if (cache)
+			{
+				h.slot = slot;
+				h.state = cache->slot(slot).state.load();
+			}
+			return h;
+		}
+		const _Float* data() const { return values; }
+		size_t size() const { return count; }
+		const _Float* begin() const { return values; }
+		const _Float* end() const { return values + count; }
+		_Float operator[](size_t n) const { return values[n]; }
+	};
+
+  private:
+	typedef _detail::shared_cache_header header_t;
+	typedef _detail::shared_cache_slot slot_t;
+
+	static constexpr size_t NoSlot = ~size_t(0);
+
+	uint8_t* base = nullptr;
+	size_t length = 0;
+	size_t slotsOffset = 0, dataOffset = 0;
+	uint32_t client = 0;
+	// This process's pins per slot; its bit in the slot is set while the count is nonzero.
+	std::vector<uint32_t> localPins;
+	std::array<std::mutex, 64> pinLocks;
+
+	header_t& header() const { return *reinterpret_cast<header_t*>(base); }
+	slot_t& slot(size_t i) const { return reinterpret_cast<slot_t*>(base + slotsOffset)[i]; }
+	_Float* slot_values(size_t i) const
+	{
+		return reinterpret_cast<_Float*>(base + dataOffset) + i * header().slotValues;
+	}
+	uint64_t bit() const { return uint64_t(1) << client; }
+
+	static uint64_t cpu_ns()
+	{
+		timespec t;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+		return uint64_t(t.tv_sec) * 1000000000u + uint64_t(t.tv_nsec);
+	}
+
+	static bool alive(int32_t pid) { return kill(pid, 0) == 0 || errno != ESRCH; }
+
+	// Pins slot i if it still holds key in the state seen as expected.
+	bool pin(size_t i, uint64_t expected, const ChunkKey& key)
+	{
+		slot_t& s = slot(i);
+		{
+			std::lock_guard<std::mutex> lock(pinLocks[i % pinLocks.size()]);
+			if (localPins[i]++ == 0)
+			{
+				s.pinners.fetch_or(bit());
+			}
+		}
+		// An evictor claims the slot before reading the pins, so either it sees this bit or this load sees its claim.
+		if (s.state.load() == expected && s.key == key)
+		{
+			return true;
+		}
+		unpin(i);
+		return false;
+	}
+
+	void unpin(size_t i)
+	{
+		std::lock_guard<std::mutex> lock(pinLocks[i % pinLocks.size()]);
+		if (--localPins[i] == 0)
+		{
+			slot(i).pinners.fetch_and(~bit());
+		}
+	}
+
+	// Claims an empty slot of the bucket, or else its least recently used unpinned chunk, for tag, setting claimed to
+	// the slot's Filling word. Returns NoSlot if every slot is pinned or being generated.
+	size_t claim(size_t bucket, uint32_t tag, uint64_t& claimed)
+	{
+		for (uint32_t attempt = 0; attempt < Ways; ++attempt)
+		{
+			size_t victim = NoSlot;
+			uint64_t victimWord = 0, oldest = ~uint64_t(0);
+			for (size_t i = bucket; i < bucket + Ways; ++i)
+			{
+				slot_t& s = slot(i);
+				uint64_t w = s.state.load();
+				uint64_t state = slot_t::state_of(w);
+				if (state == slot_t::Empty
+				    || (state == slot_t::Ready && s.pinners.load() == 0 && s.lastUse.load() < oldest))
+				{
+					victim = i;
+					victimWord = w;
+					oldest = state == slot_t::Empty ? 0 : s.lastUse.load();
+				}
+			}
+			if (victim == NoSlot)
+			{
+				return NoSlot;
+			}
+
+			slot_t& s = slot(victim);
+			claimed = slot_t::word(slot_t::Filling, slot_t::generation_of(victimWord) + 1, tag, client);
+			uint64_t expected = victimWord;
+			if (!s.state.compare_exchange_strong(expected, claimed))
+			{
+				continue;
+			}
+			if (s.pinners.load() != 0)
+			{
+				release(victim, claimed, victimWord);
+				continue;
+			}
+
+			if (slot_t::state_of(victimWord) == slot_t::Ready)
+			{
+				header().evictions.fetch_add(1, std::memory_order_relaxed);
+				header().bytes.fetch_sub(s.count * sizeof(_Float), std::memory_order_relaxed);
+			}
+			return victim;
+		}
+		return NoSlot;
+	}
+
+	// Moves slot i on from the Filling word this process claimed it with. Fails only if recover() has freed the slot,
+	// having taken this process for dead.
+	bool release(size_t i, uint64_t claimed, uint64_t next)
+	{
+		return slot(i).state.compare_exchange_strong(claimed, next);
+	}
+
+	// The Empty word a claimed slot returns to when nothing is cached in it.
+	static uint64_t emptied(uint64_t claimed) { return slot_t::word(slot_t::Empty, slot_t::generation_of(claimed), 0); }
+
+	size_t bucket_of(uint64_t hash) const { return size_t(hash % (header().slotCount / Ways)) * Ways; }
+
+	// Pins and returns the slot of the bucket holding key, or NoSlot, noting whether one is being generated.
+	size_t lookup(const ChunkKey& key, size_t bucket, uint32_t tag, bool& inFlight)
+	{
+		inFlight = false;
+		for (size_t i = bucket; i < bucket + Ways; ++i)
+		{
+			uint64_t w = slot(i).state.load();
+			if (slot_t::tag_of(w) != tag)
+			{
+				continue;
+			}
+			if (slot_t::state_of(w) == slot_t::Ready && pin(i, w, key))
+			{
+				return i;
+			}
+			inFlight |= slot_t::state_of(w) == slot_t::Filling;
+		}
+		return NoSlot;
+	}
+
+	// A view of pinned slot i, counted as a hit.
+	ChunkView hit(size_t i)
+	{
+		header_t& h = header();
+		slot_t& s = slot(i);
+		h.hits.fetch_add(1, std::memory_order_relaxed);
+		h.savedNs.fetch_add(s.costNs, std::memory_order_relaxed);
+		s.lastUse.store(h.clock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+		return ChunkView(this, i, slot_values(i), size_t(s.count));
+	}
+
+	void wait(uint32_t attempt)
+	{
+		if (attempt < 64)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			if (attempt % 64 == 0)
+			{
+				recover();
+			}
+		}
+	}
+
+  public:
+	// Opens the segment called name (as for shm_open, e.g. "/terrain"), creating it if it does not exist yet.
+	// Every process must give the same slotCount and slotValues, the values a chunk may hold at most.
+	SharedChunkCache(const std::string& name, size_t slotCount, size_t slotValues)
+	{
+		slotCount = std::max((slotCount + Ways - 1) / Ways * Ways, size_t(Ways));
+		slotsOffset = (sizeof(header_t) + 63) & ~size_t(63);
+		dataOffset = (slotsOffset + slotCount * sizeof(slot_t) + 4095) & ~size_t(4095);
+		length = dataOffset + slotCount * slotValues * sizeof(_Float);
+
+		bool created = true;
+		int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd < 0 && errno == EEXIST)
+		{
+			created = false;
+			fd = shm_open(name.c_str(), O_RDWR, 0);
+		}
+		if (fd < 0)
+		{
+			throw std::runtime_error("Cannot open shared memory " + name + ": " + std::strerror(errno));
+		}
+
+		// The creator sizes the segment and then publishes the magic; openers wait for both.
+		if (created && ftruncate(fd, off_t(length)) != 0)
+		{
+			::close(fd);
+			shm_unlink(name.c_str());
+			throw std::runtime_error("Cannot size shared memory " + name);
+		}
+		struct stat st;
+		for (int tries = 0; !created && fstat(fd, &st) == 0 && size_t(st.st_size) != length && tries < 1000; ++tries)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (!created && (fstat(fd, &st) != 0 || size_t(st.st_size) != length))
+		{
+			::close(fd);
+			throw std::runtime_error("Existing shared chunk cache " + name + " has different parameters");
+		}
+
+		void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (mapped == MAP_FAILED)
+		{
+			throw std::runtime_error("Cannot map shared memory " + name);
+		}
+		base = static_cast<uint8_t*>(mapped);
+
+		header_t& h = header();
+		if (created)
+		{
+			h.valueSize = sizeof(_Float);
+			h.slotCount = uint32_t(slotCount);
+			h.slotValues = slotValues;
+			h.magic.store(header_t::Magic);
+		}
+		for (int tries = 0; h.magic.load() != header_t::Magic && tries < 1000; ++tries)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (h.magic.load() != header_t::Magic || h.valueSize != sizeof(_Float) || h.slotCount != slotCount
+		    || h.slotValues != slotValues)
+		{
+			munmap(base, length);
+			base = nullptr;
+			throw std::runtime_error("Existing shared chunk cache " + name + " has different parameters");
+		}
+
+		recover();
+		client = header_t::MaxClients;
+		for (uint32_t c = 0; c < header_t::MaxClients && client == header_t::MaxClients; ++c)
+		{
+			int32_t expected = 0;
+			if (h.clients[c].compare_exchange_strong(expected, int32_t(getpid())))
+			{
+				client = c;
+			}
+		}
+		if (client == header_t::MaxClients)
+		{
+			munmap(base, length);
+			base = nullptr;
+			throw std::runtime_error("Shared chunk cache " + name + " has no room for another process");
+		}
+		localPins.assign(slotCount, 0);
+	}
+
+	SharedChunkCache(const SharedChunkCache&) = delete;
+	SharedChunkCache& operator=(const SharedChunkCache&) = delete;
+
+	~SharedChunkCache()
+	{
+		if (!base)
+		{
+			return;
+		}
+		for (size_t i = 0; i < localPins.size(); ++i)
+		{
+			if (localPins[i] != 0)
+			{
+				slot(i).pinners.fetch_and(~bit());
+			}
+		}
+		header().clients[client].store(0);
+		munmap(base, length);
+	}
+
+	// Removes the segment's name; processes that have it open keep using it until they close it.
+	static void remove(const std::string& name) { shm_unlink(name.c_str()); }
+
+	// Releases the pins and unfinished chunks of every attached process that has died, returning how many did.
+	size_t recover()
+	{
+		header_t& h = header();
+		size_t count = 0;
+		for (uint32_t c = 0; c < header_t::MaxClients; ++c)
+		{
+			int32_t pid = h.clients[c].load();
+			if (pid == 0 || alive(pid))
+			{
+				continue;
+			}
+			for (size_t i = 0; i < h.slotCount; ++i)
+			{
+				slot_t& s = slot(i);
+				s.pinners.fetch_and(~(uint64_t(1) << c));
+				uint64_t w = s.state.load();
+				if (slot_t::state_of(w) == slot_t::Filling && slot_t::filler_of(w) == c)
+				{
+					s.state.compare_exchange_strong(w, emptied(w));
+				}
+			}
+			if (h.clients[c].compare_exchange_strong(pid, 0))
+			{
+				h.recovered.fetch_add(1, std::memory_order_relaxed);
+				++count;
+			}
+		}
+		return count;
+	}
+
+	// Returns the chunk for key, calling generate(_Float*) to fill its count values if no process has it cached or
+	// in flight. If generate throws, the exception propagates and nothing is cached.
+	template<typename _Generate>
+	ChunkView get(const ChunkKey& key, size_t count, _Generate&& generate)
+	{
+		header_t& h = header();
+		if (count > h.slotValues)
+		{
+			throw std::invalid_argument("A chunk is larger than the slots of the shared chunk cache");
+		}
+
+		uint64_t hash = uint64_t(ChunkKeyHash{}(key));
+		uint32_t tag = uint32_t(hash >> 32);
+		size_t bucket = bucket_of(hash);
+		for (uint32_t attempt = 0;; ++attempt)
+		{
+			bool inFlight;
+			size_t found = lookup(key, bucket, tag, inFlight);
+			if (found != NoSlot)
+			{
+				return hit(found);
+			}
+			if (inFlight)
+			{
+				wait(attempt);
+				continue;
+			}
+
+			uint64_t claimed;
+			size_t i = claim(bucket, tag, claimed);
+			if (i == NoSlot)
+			{
+				h.misses.fetch_add(1, std::memory_order_relaxed);
+				std::vector<_Float> local(count);
+				generate(local.data());
+				return ChunkView(std::move(local));
+			}
+
+			// Another process may have claimed a slot for the same chunk meanwhile. The lower slot is kept, or the
+			// other's if it is already done.
+			slot_t& s = slot(i);
+			bool duplicate = false;
+			for (size_t j = bucket; j < bucket + Ways; ++j)
+			{
+				uint64_t w = slot(j).state.load();
+				if (j == i || slot_t::tag_of(w) != tag)
+				{
+					continue;
+				}
+				if (slot_t::state_of(w) == slot_t::Ready && pin(j, w, key))
+				{
+					release(i, claimed, emptied(claimed));
+					return hit(j);
+				}
+				duplicate |= slot_t::state_of(w) == slot_t::Filling && j < i;
+			}
+			if (duplicate)
+			{
+				release(i, claimed, emptied(claimed));
+				continue;
+			}
+			h.misses.fetch_add(1, std::memory_order_relaxed);
+
+			s.key = key;
+			s.count = count;
+			uint64_t start = cpu_ns();
+			try
+			{
+				generate(slot_values(i));
+			}
+			catch (...)
+			{
+				release(i, claimed, emptied(claimed));
+				throw;
+			}
+			s.costNs = cpu_ns() - start;
+			s.lastUse.store(h.clock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+
+			// Pinned before it is published, so that no other process can evict it first.
+			{
+				std::lock_guard<std::mutex> lock(pinLocks[i % pinLocks.size()]);
+				if (localPins[i]++ == 0)
+				{
+					s.pinners.fetch_or(bit());
+				}
+			}
+			if (!release(i, claimed, slot_t::word(slot_t::Ready, slot_t::generation_of(claimed), tag)))
+			{
+				// The slot was freed under this process and may be refilled already, so its values are not kept.
+				unpin(i);
+				std::vector<_Float> local(count);
+				generate(local.data());
+				return ChunkView(std::move(local));
+			}
+			h.generatedNs.fetch_add(s.costNs, std::memory_order_relaxed);
+			h.bytes.fetch_add(count * sizeof(_Float), std::memory_order_relaxed);
+			return ChunkView(this, i, slot_values(i), count);
+		}
+	}
+
+	// Returns the chunk for key if it is cached, or an empty view, without generating or waiting for it.
+	ChunkView find(const ChunkKey& key)
+	{
+		uint64_t hash = uint64_t(ChunkKeyHash{}(key));
+		bool inFlight;
+		size_t found = lookup(key, bucket_of(hash), uint32_t(hash >> 32), inFlight);
+		return found == NoSlot ? ChunkView() : hit(found);
+	}
+
+	// Returns the chunk another process named by handle, or an empty view if it no longer holds key.
+	ChunkView open(const SharedChunkHandle& handle, const ChunkKey& key)
+	{
+		if (handle.slot >= header().slotCount || slot_t::state_of(handle.state) != slot_t::Ready
+		    || !pin(size_t(handle.slot), handle.state, key))
+		{
+			return ChunkView();
+		}
+		size_t i = size_t(handle.slot);
+		return ChunkView(this, i, slot_values(i), size_t(slot(i).count));
+	}
+
+	// Returns the chunk at the given chunk coordinate, laid out as by ChunkCache::get().
+	template<typename _Noise>
+	ChunkView get(
+	      const _Noise& noise,
+	      const std::array<int64_t, _Noise::Dimensions>& chunk,
+	      size_t chunkSize,
+	      double frequency)
+	{
+		constexpr uint32_t _Dimensions = _Noise::Dimensions;
+		static_assert(std::is_same<typename _Noise::float_type, _Float>::value, "Cache and noise value types differ");
+
+		ChunkKey key;
+		key.seed = noise.seed();
+		key.seedType = noise.seed_type();
+		key.mode = _Noise::NoiseMode;
+		key.dimensions = _Dimensions;
+		key.set_kernel<typename _Noise::radius_sq_type, typename _Noise::int_type>();
+		std::copy(chunk.begin(), chunk.end(), key.chunk.begin());
+		key.frequency = frequency;
+		key.chunkSize = chunkSize;
+
+		std::array<size_t, _Dimensions> size;
+		std::array<_Float, _Dimensions> origin;
+		size_t count = 1;
+		for (uint32_t k = 0; k < _Dimensions; ++k)
+		{
+			size[k] = chunkSize;
+			origin[k] = _Float(double(chunk[k]) * double(chunkSize) * frequency);
+			count *= chunkSize;
+		}
+		return get(key, count, [&](_Float* values) { noise.generate(values, size, origin, _Float(frequency)); });
+	}
+
+	// Slots pinned by any process.
+	size_t pinned() const
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < header().slotCount; ++i)
+		{
+			count += slot(i).pinners.load() != 0;
+		}
+		return count;
+	}
+
+	// Totals over every process that has used the segment.
+	SharedChunkCacheStats stats() const
+	{
+		const header_t& h = header();
+		SharedChunkCacheStats s;
+		s.hits = h.hits.load(std::memory_order_relaxed);
+		s.misses = h.misses.load(std::memory_order_relaxed);
+		s.evictions = h.evictions.load(std::memory_order_relaxed);
+		s.bytes = h.bytes.load(std::memory_order_relaxed);
+		s.recovered = h.recovered.load(std::memory_order_relaxed);
+		s.generated_seconds = double(h.generatedNs.load(std::memory_order_relaxed)) * 1e-9;
+		s.saved_seconds = double(h.savedNs.load(std::memory_order_relaxed)) * 1e-9;
+		return s;
+	}
+};
+
+} // namespace osn
+
+#endif
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "opensimplex2s.hpp"
+
+#include <cstdio>
+#include <vector>
+
+
+namespace osn
+{
+
+// Streams a width * height 2D heightmap as bands of rows, so that maps far larger than memory can be produced
+// with a buffer of only bandRows * width values.
+// Sample (i, j) lies at (x0 + i * step, y0 + j * step).
+//
+// Nothing of the lattice is carried from one band to the next, because there is nothing to carry: the 2D grid path
+// keeps no per-row state, and each sample hashes its own few lattice points from the L1-resident tables. A band is
+// one generate() call, so a boundary costs one call and one sink call. One-row bands stream as fast as 256-row
+// ones within run-to-run noise, as test_scanline_stream measures.
+template<typename _Noise>
+class ScanlineStream
+{
+	static_assert(_Noise::Dimensions == 2, "ScanlineStream generates 2D heightmaps");
+
+  public:
+	typedef typename _Noise::float_type float_type;
+
+  private:
+	const _Noise& noise;
+	size_t width, height;
+	double x0, y0, step;
+	size_t bandRows;
+	size_t nextRow = 0;
+	std::vector<float_type> band;
+
+  public:
+	ScanlineStream(
+	      const _Noise& noise,
+	      size_t width,
+	      size_t height,
+	      double x0,
+	      double y0,
+	      double step,
+	      size_t bandRows = 64)
+	    : noise(noise)
+	    , width(width)
+	    , height(height)
+	    , x0(x0)
+	    , y0(y0)
+	    , step(step)
+	    , bandRows(bandRows == 0 ? 1 : bandRows)
+	    , band(width * this->bandRows)
+	{
+	}
+
+	size_t row() const { return nextRow; }
+	bool done() const { return nextRow >= height; }
+
+	// Resumes from the given row, e.g. after an interrupted export.
+	void seek(size_t row) { nextRow = std::min(row, height); }
+
+	// Generates the next band and points rows at it. Returns the number of rows in the band, 0 once done.
+	// The band stays valid until the next call.
+	size_t next(const float_type*& rows)
+	{
+		size_t count = std::min(bandRows, height - nextRow);
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		noise.generate(
+		      band.data(),
+		      { width, count },
+		      { float_type(x0), float_type(y0 + double(nextRow) * step) },
+		      float_type(step));
+		nextRow += count;
+
+		rows = band.data();
+		return count;
+	}
+
+	// Calls sink(rows, firstRow, rowCount) for every remaining band.
+	template<typename _Sink>
+	void run(_Sink&& sink)
+	{
+		const float_type* rows;
+		size_t first = nextRow;
+		while (size_t count = next(rows))
+		{
+			sink(rows, first, count);
+			first += count;
+		}
+	}
+
+	// Writes every remaining band to file as raw native-endian values. Returns false on a write error.
+	bool write(std::FILE* file)
+	{
+		const float_type* rows;
+		while (size_t count = next(rows))
+		{
+			if (std::fwrite(rows, sizeof(float_type), count * width, file) != count * width)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+} // namespace osn
@@ -0,0 +1,382 @@
+#pragma once
+
+#include "opensimplex2s.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace osn
+{
+
+enum class VolumeValueType : uint32_t
+{
+	Float32 = 0,
+	Float64 = 1
+};
+
+// On-disk layout of a tiled volume: this header, one state byte per tile (the tile index), then padding up to
+// dataOffset and the tiles themselves. Each tile holds tileSize^3 values with x varying fastest, and tiles are
+// ordered the same way. Tiles on the far edges are stored whole, past the volume size.
+struct VolumeHeader
+{
+	static constexpr char Magic[8] = { 'O', 'S', 'N', 'V', 'O', 'L', '\0', '\0' };
+	static constexpr uint32_t Version = 3;
+	static constexpr uint64_t Alignment = 4096;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t valueType;
+	uint64_t seed;
+	uint32_t mode;
+	uint32_t tileSize;
+	uint32_t seedType; // seed_type_of() the seed's type.
+	uint32_t intType;  // seed_type_of() the integer type the lattice is floored in.
+	int64_t radiusNum; // The kernel's squared radius, radiusNum / radiusDen.
+	int64_t radiusDen;
+	double frequency;
+	double origin[3];
+	uint64_t size[3];
+	uint64_t tiles[3];
+	uint64_t dataOffset;
+
+	uint64_t tile_count() const { return tiles[0] * tiles[1] * tiles[2]; }
+	uint64_t tile_values() const { return uint64_t(tileSize) * tileSize * tileSize; }
+};
+
+namespace _detail
+{
+	// Read-write or read-only shared mapping of a whole file.
+	class mapped_file
+	{
+		uint8_t* base = nullptr;
+		uint64_t length = 0;
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+#else
+		int fd = -1;
+#endif
+
+		void close()
+		{
+#ifdef _WIN32
+			if (base)
+				UnmapViewOfFile(base);
+			if (mapping)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+			file = INVALID_HANDLE_VALUE;
+			mapping = nullptr;
+#else
+			if (base)
+				munmap(base, length);
+			if (fd >= 0)
+				::close(fd);
+			fd = -1;
+#endif
+			base = nullptr;
+			length = 0;
+		}
+
+	  public:
+		mapped_file() = default;
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+		mapped_file(mapped_file&& o) noexcept { *this = std::move(o); }
+		mapped_file& operator=(mapped_file&& o) noexcept
+		{
+			close();
+			std::swap(base, o.base);
+			std::swap(length, o.length);
+#ifdef _WIN32
+			std::swap(file, o.file);
+			std::swap(mapping, o.mapping);
+#else
+			std::swap(fd, o.fd);
+#endif
+			return *this;
+		}
+		~mapped_file() { close(); }
+
+		// Maps path, growing or creating it to minSize bytes when writable.
+		void open(const std::string& path, bool writable, uint64_t minSize = 0)
+		{
+			close();
+#ifdef _WIN32
+			file = CreateFileA(
+			      path.c_str(),
+			      writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+			      FILE_SHARE_READ | (writable ? 0 : FILE_SHARE_WRITE),
+			      nullptr,
+			      writable ? OPEN_ALWAYS : OPEN_EXISTING,
+			      FILE_ATTRIBUTE_NORMAL,
+			      nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				throw std::runtime_error("Cannot open " + path);
+
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(file, &fileSize))
+				throw std::runtime_error("Cannot stat " + path);
+			length = std::max(uint64_t(fileSize.QuadPart), writable ? minSize : 0);
+			if (length == 0)
+				throw std::runtime_error("Empty volume file " + path);
+
+			mapping = CreateFileMappingA(
+			      file,
+			      nullptr,
+			      writable ? PAGE_READWRITE : PAGE_READONLY,
+			      DWORD(length >> 32),
+			      DWORD(length),
+			      nullptr);
+			if (!mapping)
+				throw std::runtime_error("Cannot map " + path);
+
+			base = static_cast<uint8_t*>(
+			      MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, SIZE_T(length)));
+#else
+			fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+			if (fd < 0)
+				throw std::runtime_error("Cannot open " + path);
+
+			struct stat st;
+			if (fstat(fd, &st) != 0)
+				throw std::runtime_error("Cannot stat " + path);
+			length = uint64_t(st.st_size);
+			if (writable && length < minSize)
+			{
+				if (ftruncate(fd, off_t(minSize)) != 0)
+					throw std::runtime_error("Cannot grow " + path);
+				length = minSize;
+			}
+			if (length == 0)
+				throw std::runtime_error("Empty volume file " + path);
+
+			void* p = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+			base = p == MAP_FAILED ? nullptr : static_cast<uint8_t*>(p);
+#endif
+			if (!base)
+				throw std::runtime_error("Cannot map " + path);
+		}
+
+		uint8_t* data() const { return base; }
+		uint64_t size() const { return length; }
+
+		// Writes the pages overlapping [offset, offset + count) back to disk.
+		void flush(uint64_t offset, uint64_t count) const
+		{
+			uint64_t start = offset & ~(VolumeHeader::Alignment - 1);
+#ifdef _WIN32
+			FlushViewOfFile(base + start, SIZE_T(offset + count - start));
+#else
+			msync(base + start, offset + count - start, MS_SYNC);
+#endif
+		}
+	};
+
+	template<typename _Float>
+	struct volume_value_type;
+
+	template<>
+	struct volume_value_type<float>
+	{
+		static constexpr VolumeValueType value = VolumeValueType::Float32;
+	};
+
+	template<>
+	struct volume_value_type<double>
+	{
+		static constexpr VolumeValueType value = VolumeValueType::Float64;
+	};
+
+} // namespace _detail
+
+
+// 3D noise volume stored as bricks in a memory-mapped file.
+// Tiles are generated straight into the mapping, so the volume never needs to fit in memory, and readers map the
+// same file without copying. Each tile's state byte is set only once the tile is written; reopening a partially
+// written file with the same parameters generates just the missing tiles.
+template<typename _Float = float>
+class TiledVolume
+{
+	_detail::mapped_file file;
+	bool writable = false;
+
+	VolumeHeader* hdr() const { return reinterpret_cast<VolumeHeader*>(file.data()); }
+	uint8_t* states() const { return file.data() + sizeof(VolumeHeader); }
+
+	TiledVolume() = default;
+
+  public:
+	TiledVolume(TiledVolume&&) = default;
+	TiledVolume& operator=(TiledVolume&&) = default;
+
+	// Creates the volume file, or reopens it for resuming if it already describes the same volume.
+	// Sample (x, y, z) lies at (origin + (x, y, z) * frequency).
+	template<typename _Noise>
+	static TiledVolume create(
+	      const std::string& path,
+	      const _Noise& noise,
+	      const std::array<uint64_t, 3>& size,
+	      const std::array<double, 3>& origin,
+	      double frequency,
+	      uint32_t tileSize = 32)
+	{
+		static_assert(_Noise::Dimensions == 3, "Tiled volumes hold 3D noise");
+		static_assert(std::is_same<typename _Noise::float_type, _Float>::value, "Volume and noise value types differ");
+		if (tileSize == 0)
+			throw std::invalid_argument("Tile size must be positive");
+
+		VolumeHeader h{};
+		std::memcpy(h.magic, VolumeHeader::Magic, sizeof(h.magic));
+		h.version = VolumeHeader::Version;
+		h.valueType = uint32_t(_detail::volume_value_type<_Float>::value);
+		h.seed = noise.seed();
+		h.seedType = noise.seed_type();
+		h.mode = uint32_t(_Noise::NoiseMode);
+		h.tileSize = tileSize;
+		h.intType = seed_type_of<typename _Noise::int_type>();
+		h.radiusNum = int64_t(_Noise::radius_sq_type::num);
+		h.radiusDen = int64_t(_Noise::radius_sq_type::den);
+		h.frequency = frequency;
+		for (int k = 0; k < 3; ++k)
+		{
+			h.origin[k] = origin[k];
+			h.size[k] = size[k];
+			h.tiles[k] = (size[k] + tileSize - 1) / tileSize;
+		}
+		uint64_t indexEnd = sizeof(VolumeHeader) + h.tile_count();
+		h.dataOffset = (indexEnd + VolumeHeader::Alignment - 1) & ~(VolumeHeader::Alignment - 1);
+
+		TiledVolume v;
+		v.writable = true;
+		v.file.open(path, true, h.dataOffset + h.tile_count() * h.tile_values() * sizeof(_Float));
+
+		// A freshly grown file reads as zeros, i.e. no magic and every tile missing.
+		if (std::memcmp(v.hdr()->magic, VolumeHeader::Magic, sizeof(h.magic)) == 0)
+		{
+			VolumeHeader& e = *v.hdr();
+			bool same = e.version == h.version && e.valueType == h.valueType && e.seed == h.seed
+			            && e.seedType == h.seedType && e.mode == h.mode && e.tileSize == h.tileSize
+			            && e.intType == h.intType && e.radiusNum == h.radiusNum && e.radiusDen == h.radiusDen
+			            && e.frequency == h.frequency && e.dataOffset == h.dataOffset;
+			for (int k = 0; k < 3; ++k)
+				same = same && e.origin[k] == h.origin[k] && e.size[k] == h.size[k];
+			if (!same)
+				throw std::runtime_error("Existing volume " + path + " has different parameters");
+		}
+		else
+		{
+			std::memset(v.states(), 0, size_t(h.tile_count()));
+			*v.hdr() = h;
+		}
+		return v;
+	}
+
+	// Maps an existing volume read-only.
+	static TiledVolume open(const std::string& path)
+	{
+		TiledVolume v;
+		v.file.open(path, false);
+
+		const VolumeHeader& h = *v.hdr();
+		if (v.file.size() < sizeof(VolumeHeader) || std::memcmp(h.magic, VolumeHeader::Magic, sizeof(h.magic)) != 0
+		    || h.version != VolumeHeader::Version || h.tileSize == 0)
+			throw std::runtime_error(path + " is not a tiled noise volume");
+		if (h.valueType != uint32_t(_detail::volume_value_type<_Float>::value))
+			throw std::runtime_error(path + " holds a different value type");
+		if (v.file.size() < h.dataOffset + h.tile_count() * h.tile_values() * sizeof(_Float))
+			throw std::runtime_error(path + " is truncated");
+		return v;
+	}
+
+	const VolumeHeader& header() const { return *hdr(); }
+
+	uint64_t tile_index(uint64_t tx, uint64_t ty, uint64_t tz) const
+	{
+		return (tz * hdr()->tiles[1] + ty) * hdr()->tiles[0] + tx;
+	}
+
+	bool tile_complete(uint64_t tile) const { return states()[tile] != 0; }
+
+	uint64_t missing_tiles() const
+	{
+		uint64_t missing = 0;
+		for (uint64_t t = 0; t < hdr()->tile_count(); ++t)
+			missing += states()[t] == 0;
+		return missing;
+	}
+
+	const _Float* tile(uint64_t tile) const
+	{
+		return reinterpret_cast<const _Float*>(file.data() + hdr()->dataOffset) + tile * hdr()->tile_values();
+	}
+
+	_Float at(uint64_t x, uint64_t y, uint64_t z) const
+	{
+		uint64_t t = hdr()->tileSize;
+		const _Float* values = tile(tile_index(x / t, y / t, z / t));
+		return values[((z % t) * t + (y % t)) * t + (x % t)];
+	}
+
+	// Generates every missing tile, up to maxTiles of them. With durable set, each tile is flushed to disk before
+	// being marked complete, so a power loss cannot leave a tile marked but unwritten.
+	// Returns the number of tiles generated. The noise must have the seed, mode and kernel the volume was created with.
+	template<typename _Noise>
+	uint64_t generate(const _Noise& noise, uint64_t maxTiles = ~uint64_t(0), bool durable = false)
+	{
+		static_assert(std::is_same<typename _Noise::float_type, _Float>::value, "Volume and noise value types differ");
+		if (!writable)
+			throw std::runtime_error("Volume is mapped read-only");
+
+		const VolumeHeader& h = *hdr();
+		if (noise.seed() != h.seed || noise.seed_type() != h.seedType || uint32_t(_Noise::NoiseMode) != h.mode)
+			throw std::invalid_argument("Noise seed or mode differs from the volume's");
+		if (seed_type_of<typename _Noise::int_type>() != h.intType || int64_t(_Noise::radius_sq_type::num) != h.radiusNum
+		    || int64_t(_Noise::radius_sq_type::den) != h.radiusDen)
+			throw std::invalid_argument("Noise kernel differs from the volume's");
+		uint64_t generated = 0;
+		for (uint64_t tz = 0; tz < h.tiles[2]; ++tz)
+			for (uint64_t ty = 0; ty < h.tiles[1]; ++ty)
+				for (uint64_t tx = 0; tx < h.tiles[0] && generated < maxTiles; ++tx)
+				{
+					uint64_t t = tile_index(tx, ty, tz);
+					if (tile_complete(t))
+						continue;
+
+					_Float* values = const_cast<_Float*>(tile(t));
+					noise.generate(
+					      values,
+					      { h.tileSize, h.tileSize, h.tileSize },
+					      { _Float(h.origin[0] + double(tx * h.tileSize) * h.frequency),
+					        _Float(h.origin[1] + double(ty * h.tileSize) * h.frequency),
+					        _Float(h.origin[2] + double(tz * h.tileSize) * h.frequency) },
+					      _Float(h.frequency));
+
+					if (durable)
+						file.flush(uint64_t(reinterpret_cast<uint8_t*>(values) - file.data()),
+						           h.tile_values() * sizeof(_Float));
+					states()[t] = 1;
+					++generated;
+				}
+		return generated;
+	}
+
+	void flush() const { file.flush(0, file.size()); }
+};
+
+} // namespace osn
@@ -1,9 +1,34 @@
 #pragma once
 
 #include "../opensimplex2s.hpp"
+#include "../opensimplex2s_any.hpp"
+#include "../opensimplex2s_async.hpp"
+#include "../opensimplex2s_cache.hpp"
+#include "../opensimplex2s_graph.hpp"
+#include "../opensimplex2s_perf.hpp"
+#include "../opensimplex2s_pyramid.hpp"
+#include "../opensimplex2s_quadtree.hpp"
+#include "../opensimplex2s_service.hpp"
+#include "../opensimplex2s_shared_cache.hpp"
+#include "../opensimplex2s_stream.hpp"
+#include "../opensimplex2s_volume.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 using namespace osn;
 
@@ -15,8 +40,1548 @@ using namespace osn;
 float values[N_VALUES];
 
 
-void main()
+bool test_fixed_2d()
+{
+	constexpr size_t width = 1024, height = 1024;
+	constexpr double step = 0.0173;
+
+	static uint16_t fixed_values[width * height];
+	static uint16_t float_values[width * height];
+
+	OpenSimplex2S<2, osn::Mode::Standard_2D> osn2d(1234);
+
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+
+	for (size_t iter = 0; iter < ITERATIONS; ++iter)
+		osn2d.generate_u16(fixed_values, width, height, -5.0, -7.0, step);
+
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float fixed_time = std::chrono::duration<float>(end - start).count() / ITERATIONS;
+
+	start = std::chrono::high_resolution_clock::now();
+
+	for (size_t iter = 0; iter < ITERATIONS; ++iter)
+		for (size_t j = 0; j < height; ++j)
+			for (size_t i = 0; i < width; ++i)
+			{
+				float v = osn2d(float(-5.0 + i * step), float(-7.0 + j * step));
+				float_values[j * width + i] = uint16_t(std::min(std::max((v + 1) * 32768.0f, 0.0f), 65535.0f));
+			}
+
+	end = std::chrono::high_resolution_clock::now();
+	float float_time = std::chrono::duration<float>(end - start).count() / ITERATIONS;
+
+	int max_error = 0;
+	double sum_error = 0;
+	for (size_t i = 0; i < width * height; ++i)
+	{
+		int error = std::abs(int(fixed_values[i]) - int(float_values[i]));
+		max_error = std::max(max_error, error);
+		sum_error += error;
+	}
+
+	std::cout << "2D fixed-point uint16 for " << width * height << " values took " << fixed_time << " seconds (float "
+	          << float_time << " seconds), max error " << max_error << ", mean error "
+	          << sum_error / (width * height) << "\n";
+
+	// Coordinates past the 32.32 range are reduced to the lattice period, and non-finite ones read as 0.
+	constexpr double infinity = std::numeric_limits<double>::infinity();
+	uint16_t far[16], origin[16], undefined[16];
+	osn2d.generate_u16(far, 4, 4, 1e300, -3e18, 7e20);
+	osn2d.generate_u16(origin, 4, 4, 0.0, 0.0, 0.0);
+	osn2d.generate_u16(undefined, 4, 4, std::nan(""), infinity, -infinity);
+	bool reduced = std::equal(undefined, undefined + 16, origin) && std::count(origin, origin + 16, origin[0]) == 16;
+
+	return max_error <= 256 && reduced;
+}
+
+
+bool test_chunk_cache()
+{
+	constexpr size_t chunk_size = 64;
+	constexpr double frequency = 0.01;
+	constexpr size_t n_threads = 8;
+	constexpr size_t n_requests = 1000;
+
+	OpenSimplex2S<2, osn::Mode::Standard_2D> osn2d(77);
+	bool ok = true;
+
+	// Grid generation matches point evaluation.
+	std::vector<float> grid(chunk_size * chunk_size);
+	osn2d.generate(grid.data(), { chunk_size, chunk_size }, { 3.0f, -2.0f }, float(frequency));
+	for (size_t j = 0; j < chunk_size; ++j)
+		for (size_t i = 0; i < chunk_size; ++i)
+			ok &= std::abs(grid[j * chunk_size + i] - osn2d(float(3.0 + i * frequency), float(-2.0 + j * frequency))) < 1e-4f;
+
+	// Concurrent requests for one chunk generate it once.
+	{
+		ChunkCache<float> cache(1 << 20);
+		std::atomic<int> generated{ 0 };
+		std::vector<std::thread> threads;
+		ChunkKey key;
+		key.seed = 5;
+		for (size_t t = 0; t < n_threads; ++t)
+			threads.emplace_back([&]() {
+				cache.get(key, [&](std::vector<float>& values) {
+					generated++;
+					std::this_thread::sleep_for(std::chrono::milliseconds(20));
+					values.assign(16, 1.0f);
+				});
+			});
+		for (std::thread& t : threads)
+			t.join();
+		ok &= generated == 1 && cache.stats().misses == 1 && cache.stats().hits == n_threads - 1;
+	}
+
+	// Chunks at one coordinate but of different sizes are different chunks.
+	{
+		ChunkCache<float> cache(1 << 20);
+		for (size_t size : { size_t(16), size_t(32), size_t(16), size_t(8) })
+		{
+			ChunkCache<float>::chunk_ptr chunk = cache.get(osn2d, std::array<int64_t, 2>{ 3, -2 }, size, frequency);
+			std::vector<float> expected(size * size);
+			osn2d.generate(expected.data(), { size, size }, { float(3 * size * frequency), float(-2.0 * size * frequency) }, float(frequency));
+			ok &= *chunk == expected;
+		}
+		ok &= cache.stats().misses == 3 && cache.stats().hits == 1;
+	}
+
+	// Seeds equal as uint64_t but of different types are different noise, and so different chunks.
+	{
+		ChunkCache<float> cache(1 << 20);
+		OpenSimplex2S<2, osn::Mode::Standard_2D> narrow(int32_t(-7)), wide(int64_t(-7));
+		ok &= narrow.seed() == wide.seed() && narrow.seed_type() != wide.seed_type();
+		for (const auto* noise : { &narrow, &wide })
+		{
+			std::vector<float> expected(16 * 16);
+			noise->generate(expected.data(), { 16, 16 }, { 0.0f, 0.0f }, float(frequency));
+			ok &= *cache.get(*noise, std::array<int64_t, 2>{ 0, 0 }, 16, frequency) == expected;
+		}
+		ok &= cache.stats().misses == 2;
+	}
+
+	// So are noises of one seed whose kernels differ in radius or in the integer type the lattice is floored in.
+	{
+		ChunkCache<float> cache(1 << 20);
+		OpenSimplex2S<2, osn::Mode::Standard_2D, float, int32_t, std::ratio<1, 2>> pruned(77);
+		OpenSimplex2S<2, osn::Mode::Standard_2D, float, int64_t> wide(77);
+		std::vector<float> expected(16 * 16);
+		pruned.generate(expected.data(), { 16, 16 }, { 0.0f, 0.0f }, float(frequency));
+		ok &= *cache.get(pruned, std::array<int64_t, 2>{ 0, 0 }, 16, frequency) == expected;
+		osn2d.generate(expected.data(), { 16, 16 }, { 0.0f, 0.0f }, float(frequency));
+		ok &= *cache.get(osn2d, std::array<int64_t, 2>{ 0, 0 }, 16, frequency) == expected;
+		cache.get(wide, std::array<int64_t, 2>{ 0, 0 }, 16, frequency);
+		ok &= cache.stats().misses == 3;
+	}
+
+	// Mixed-locality request streams: mostly short random walks, with occasional far jumps.
+	auto run = [&](ChunkCache<float>* cache) {
+		std::vector<std::thread> threads;
+		for (size_t t = 0; t < n_threads; ++t)
+			threads.emplace_back([&, t]() {
+				std::mt19937 rng{ uint32_t(t) };
+				std::array<int64_t, 2> chunk{ 0, 0 };
+				std::vector<float> values(chunk_size * chunk_size);
+				for (size_t r = 0; r < n_requests; ++r)
+				{
+					if (rng() % 10 == 0)
+						chunk = { int64_t(rng() % 256), int64_t(rng() % 256) };
+					else
+						chunk[rng() % 2] += int64_t(rng() % 3) - 1;
+
+					if (cache)
+						cache->get(osn2d, chunk, chunk_size, frequency);
+					else
+						osn2d.generate(values.data(),
+						               { chunk_size, chunk_size },
+						               { float(chunk[0] * chunk_size * frequency), float(chunk[1] * chunk_size * frequency) },
+						               float(frequency));
+				}
+			});
+		for (std::thread& t : threads)
+			t.join();
+	};
+
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+	run(nullptr);
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float uncached_time = std::chrono::duration<float>(end - start).count();
+
+	ChunkCache<float> cache(16 << 20);
+	start = std::chrono::high_resolution_clock::now();
+	run(&cache);
+	end = std::chrono::high_resolution_clock::now();
+	float cached_time = std::chrono::duration<float>(end - start).count();
+
+	ChunkCacheStats stats = cache.stats();
+	std::cout << "Chunk cache, " << n_threads << " threads x " << n_requests << " requests took " << cached_time
+	          << " seconds (uncached " << uncached_time << " seconds), hit rate " << stats.hit_rate() << ", "
+	          << stats.evictions << " evictions, " << stats.bytes << " bytes\n";
+
+	return ok;
+}
+
+
+bool test_scanline_stream()
+{
+	constexpr size_t width = 8192, height = 2048;
+	constexpr double step = 0.01;
+
+	OpenSimplex2S<2, osn::Mode::Standard_2D> osn2d(9);
+	bool ok = true;
+
+	// Bands match a single grid generation of the same area.
+	{
+		std::vector<float> whole(256 * 100), streamed;
+		osn2d.generate(whole.data(), { 256, 100 }, { -1.0f, 2.0f }, 0.05f);
+		ScanlineStream<decltype(osn2d)> stream(osn2d, 256, 100, -1.0, 2.0, 0.05, 7);
+		stream.run([&](const float* rows, size_t, size_t count) { streamed.insert(streamed.end(), rows, rows + count * 256); });
+		ok &= streamed.size() == whole.size();
+		for (size_t i = 0; ok && i < whole.size(); ++i)
+			ok &= std::abs(streamed[i] - whole[i]) < 1e-4f;
+	}
+
+	double checksum = 0;
+	ScanlineStream<decltype(osn2d)> stream(osn2d, width, height, 0.0, 0.0, step, 32);
+
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+	stream.run([&](const float* rows, size_t, size_t count) { checksum += rows[count * width - 1]; });
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float stream_time = std::chrono::duration<float>(end - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t j = 0; j < height; ++j)
+		for (size_t i = 0; i < width; ++i)
+			checksum += osn2d(float(i * step), float(j * step));
+	end = std::chrono::high_resolution_clock::now();
+	float point_time = std::chrono::duration<float>(end - start).count();
+
+	double megabytes = double(width * height * sizeof(float)) / (1 << 20);
+	std::cout << "Scanline stream of " << width << "x" << height << " sustained " << megabytes / stream_time
+	          << " MB/s (per-point " << megabytes / point_time << " MB/s), checksum " << checksum << "\n";
+
+	// Band boundaries cost only their generate() and sink calls, so the band height barely matters.
+	std::cout << "  by band rows:";
+	for (size_t rows : { size_t(1), size_t(4), size_t(16), size_t(64), size_t(256) })
+	{
+		ScanlineStream<decltype(osn2d)> banded(osn2d, width, 512, 0.0, 0.0, step, rows);
+		start = std::chrono::high_resolution_clock::now();
+		banded.run([&](const float* rows, size_t, size_t count) { checksum += rows[count * width - 1]; });
+		end = std::chrono::high_resolution_clock::now();
+		std::cout << " " << rows << ": " << double(width * 512 * sizeof(float)) / (1 << 20) / std::chrono::duration<float>(end - start).count() << " MB/s";
+	}
+	std::cout << "\n";
+
+	return ok;
+}
+
+
+bool test_tiled_volume()
+{
+	constexpr uint64_t size = 256;
+	constexpr double frequency = 0.02;
+	const char* path = "osn_volume_test.bin";
+
+	OpenSimplex2S<3, osn::Mode::XZBeforeY_3D> osn3d(31);
+	bool ok = true;
+	std::remove(path);
+
+	// Write part of the volume, then resume from the file.
+	uint64_t first = 0, rest = 0;
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+	{
+		TiledVolume<float> volume = TiledVolume<float>::create(path, osn3d, { size, size, size }, { 1.0, 2.0, 3.0 }, frequency);
+		first = volume.generate(osn3d, 100);
+	}
+	{
+		TiledVolume<float> volume = TiledVolume<float>::create(path, osn3d, { size, size, size }, { 1.0, 2.0, 3.0 }, frequency);
+		ok &= volume.missing_tiles() == volume.header().tile_count() - first;
+		rest = volume.generate(osn3d);
+		volume.flush();
+	}
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float write_time = std::chrono::duration<float>(end - start).count();
+
+	// Noise other than the volume's must not fill it, and tiles must hold samples.
+	int rejected = 0;
+	{
+		TiledVolume<float> volume = TiledVolume<float>::create(path, osn3d, { size, size, size }, { 1.0, 2.0, 3.0 }, frequency);
+		try
+		{
+			volume.generate(OpenSimplex2S<3, osn::Mode::XZBeforeY_3D>(32));
+		}
+		catch (const std::invalid_argument&)
+		{
+			++rejected;
+		}
+		try
+		{
+			volume.generate(OpenSimplex2S<3, osn::Mode::Classic_3D>(31));
+		}
+		catch (const std::invalid_argument&)
+		{
+			++rejected;
+		}
+		try
+		{
+			volume.generate(OpenSimplex2S<3, osn::Mode::XZBeforeY_3D>(uint64_t(31)));
+		}
+		catch (const std::invalid_argument&)
+		{
+			++rejected;
+		}
+		try
+		{
+			volume.generate(OpenSimplex2S<3, osn::Mode::XZBeforeY_3D, float, int32_t, std::ratio<1, 2>>(31));
+		}
+		catch (const std::invalid_argument&)
+		{
+			++rejected;
+		}
+		try
+		{
+			volume.generate(OpenSimplex2S<3, osn::Mode::XZBeforeY_3D, float, int64_t>(31));
+		}
+		catch (const std::invalid_argument&)
+		{
+			++rejected;
+		}
+	}
+	try
+	{
+		TiledVolume<float>::create("osn_volume_empty.bin", osn3d, { size, size, size }, { 0.0, 0.0, 0.0 }, frequency, 0);
+	}
+	catch (const std::invalid_argument&)
+	{
+		++rejected;
+	}
+	ok &= rejected == 6;
+
+	TiledVolume<float> volume = TiledVolume<float>::open(path);
+	ok &= volume.missing_tiles() == 0 && first + rest == volume.header().tile_count();
+	for (uint64_t i = 0; i < 1000; ++i)
+	{
+		uint64_t x = (i * 7919) % size, y = (i * 104729) % size, z = (i * 1299709) % size;
+		float expected = osn3d(float(1.0 + x * frequency), float(2.0 + y * frequency), float(3.0 + z * frequency));
+		ok &= std::abs(volume.at(x, y, z) - expected) < 1e-4f;
+	}
+
+	double megabytes = double(size * size * size * sizeof(float)) / (1 << 20);
+	std::cout << "Tiled volume " << size << "^3 written at " << megabytes / write_time << " MB/s in " << first + rest
+	          << " tiles (" << first << " before resume)\n";
+
+	std::remove(path);
+	return ok;
+}
+
+
+#ifdef OSN_ENABLE_COUNTERS
+bool test_counters()
+{
+	constexpr size_t n_points = 100000;
+
+	OpenSimplex2S<3, osn::Mode::Classic_3D> osn3d(3);
+	OpenSimplex2S<4, osn::Mode::XYBeforeZW_4D> osn4d(4);
+
+	NoiseCounters before = counters_snapshot();
+
+	std::thread worker([&]() {
+		for (size_t i = 0; i < n_points; ++i)
+			values[i] = osn4d(float(i) * 0.013f, float(i) * 0.007f, 1.5f, -2.5f);
+	});
+	for (size_t i = 0; i < n_points; ++i)
+		values[i] = osn3d(float(i) * 0.013f, float(i) * 0.007f, 1.5f);
+	worker.join();
+
+	NoiseCounters after = counters_snapshot();
+	NoiseCounters::for_each(after, before, [](uint64_t& a, const uint64_t& b) { a -= b; });
+
+	uint64_t rows = 0, rowTotal = 0;
+	for (size_t i = 0; i < 21; ++i)
+	{
+		rows += after.rowLength[i];
+		rowTotal += after.rowLength[i] * i;
+	}
+
+	std::cout << "Counters: 3D " << double(after.candidates3D) / after.evaluations3D << " candidates and "
+	          << double(after.contributions3D) / after.evaluations3D << " contributions per point, block 0 failed "
+	          << after.blockFailure[0] << " / succeeded " << after.blockSuccess[0] << " times; 4D "
+	          << double(after.candidates4D) / after.evaluations4D << " candidates (mean row "
+	          << double(rowTotal) / rows << ") and " << double(after.contributions4D) / after.evaluations4D
+	          << " contributions per point\n";
+
+	return after.evaluations3D == n_points && after.evaluations4D == n_points && rows == n_points
+	       && rowTotal == after.candidates4D;
+}
+#endif
+
+
+// Noise is continuous, so samples a small step apart along a line crossing many lattice cells must stay close.
+// A lattice table whose entries belong to the wrong octant shows up as jumps of over half the range.
+template<typename _Noise>
+bool test_lattice_continuity(const _Noise& noise)
+{
+	constexpr size_t steps = 200000;
+	constexpr float step = 0.001f;
+
+	float previous = noise(-11.0f, 5.0f, 7.0f), maxJump = 0.0f;
+	for (size_t i = 1; i < steps; ++i)
+	{
+		float t = float(i) * step;
+		float value = noise(t * 0.37f - 11.0f, t * 0.61f + 5.0f, t * -0.83f + 7.0f);
+		maxJump = std::max(maxJump, std::abs(value - previous));
+		previous = value;
+	}
+
+	std::cout << "Continuity " << int(_Noise::NoiseMode) << ": largest step between neighbouring samples " << maxJump
+	          << "\n";
+	return maxJump < 0.05f;
+}
+
+
+bool test_range_bounds()
+{
+	bool ok = true;
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f), extent(0.01f, 3.0f), unit(0.0f, 1.0f);
+
+	// Every sample inside a box must fall within its bound.
+	OpenSimplex2S<2, osn::Mode::Standard_2D> osn2d(11);
+	OpenSimplex2S<3, osn::Mode::XYBeforeZ_3D> osn3d(12);
+	OpenSimplex2S<4, osn::Mode::Classic_4D> osn4d(13);
+	for (int box = 0; box < 200; ++box)
+	{
+		std::array<float, 4> lo, hi;
+		for (int k = 0; k < 4; ++k)
+		{
+			lo[k] = position(rng);
+			hi[k] = lo[k] + extent(rng);
+		}
+		auto at = [&](int k) { return lo[k] + (hi[k] - lo[k]) * unit(rng); };
+		std::pair<float, float> r2 = osn2d.range({ lo[0], lo[1] }, { hi[0], hi[1] });
+		std::pair<float, float> r3 = osn3d.range({ lo[0], lo[1], lo[2] }, { hi[0], hi[1], hi[2] });
+		std::pair<float, float> r4 = osn4d.range(lo, hi);
+		std::pair<float, float> rf = osn3d.fbm_range({ lo[0], lo[1], lo[2] }, { hi[0], hi[1], hi[2] }, 4, 2.0f, 0.5f);
+		for (int i = 0; i < 200; ++i)
+		{
+			float v2 = osn2d(at(0), at(1));
+			float v3 = osn3d(at(0), at(1), at(2));
+			float v4 = osn4d(at(0), at(1), at(2), at(3));
+			float vf = osn3d.fbm(4, 2.0f, 0.5f, at(0), at(1), at(2));
+			ok &= v2 >= r2.first && v2 <= r2.second;
+			ok &= v3 >= r3.first && v3 <= r3.second;
+			ok &= v4 >= r4.first && v4 <= r4.second;
+			ok &= vf >= rf.first && vf <= rf.second;
+		}
+	}
+
+	// Marching-cubes style workload: find every cell the isosurface crosses, at two feature scales.
+	constexpr size_t cells = 128, leaf = 4;
+	constexpr float iso = 0.5f;
+	auto crossings = [&](const std::vector<float>& field, size_t n, size_t nx, size_t ny) {
+		size_t count = 0;
+		for (size_t z = 0; z < n; ++z)
+			for (size_t y = 0; y < n; ++y)
+				for (size_t x = 0; x < n; ++x)
+				{
+					int inside = 0;
+					for (int c = 0; c < 8; ++c)
+					{
+						inside += field[((z + (c >> 2)) * ny + y + ((c >> 1) & 1)) * nx + x + (c & 1)] > iso;
+					}
+					count += inside != 0 && inside != 8;
+				}
+		return count;
+	};
+
+	for (float frequency : { 0.01f, 0.03f })
+	{
+		std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+		std::vector<float> field((cells + 1) * (cells + 1) * (cells + 1));
+		osn3d.generate(field.data(), { cells + 1, cells + 1, cells + 1 }, { 0.0f, 0.0f, 0.0f }, frequency);
+		size_t dense = crossings(field, cells, cells + 1, cells + 1);
+		std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+		float dense_time = std::chrono::duration<float>(end - start).count();
+
+		// Octree descent that only samples leaf blocks whose bound straddles the isovalue.
+		start = std::chrono::high_resolution_clock::now();
+		size_t sparse = 0;
+		std::vector<std::array<size_t, 4>> visited;
+		std::vector<float> block((leaf + 1) * (leaf + 1) * (leaf + 1));
+		std::vector<std::array<size_t, 4>> stack{ { 0, 0, 0, cells } };
+		while (!stack.empty())
+		{
+			std::array<size_t, 4> b = stack.back();
+			stack.pop_back();
+			std::array<float, 3> lo{ b[0] * frequency, b[1] * frequency, b[2] * frequency };
+			std::array<float, 3> hi{ (b[0] + b[3]) * frequency, (b[1] + b[3]) * frequency, (b[2] + b[3]) * frequency };
+			std::pair<float, float> r = osn3d.range(lo, hi);
+			if (r.first > iso || r.second <= iso)
+			{
+				continue;
+			}
+			if (b[3] == leaf)
+			{
+				osn3d.generate(block.data(), { leaf + 1, leaf + 1, leaf + 1 }, lo, frequency);
+				sparse += crossings(block, leaf, leaf + 1, leaf + 1);
+				visited.push_back(b);
+				continue;
+			}
+			size_t h = b[3] / 2;
+			for (int c = 0; c < 8; ++c)
+			{
+				stack.push_back({ b[0] + (c & 1) * h, b[1] + ((c >> 1) & 1) * h, b[2] + (c >> 2) * h, h });
+			}
+		}
+		end = std::chrono::high_resolution_clock::now();
+		float sparse_time = std::chrono::duration<float>(end - start).count();
+
+		// Grid and block sampling round differently, so check against the dense field that no crossing was skipped.
+		std::vector<float> copy(block.size());
+		size_t covered = 0;
+		for (const std::array<size_t, 4>& b : visited)
+		{
+			for (size_t i = 0; i < copy.size(); ++i)
+			{
+				size_t x = i % (leaf + 1), y = i / (leaf + 1) % (leaf + 1), z = i / ((leaf + 1) * (leaf + 1));
+				copy[i] = field[((b[2] + z) * (cells + 1) + b[1] + y) * (cells + 1) + b[0] + x];
+			}
+			covered += crossings(copy, leaf, leaf + 1, leaf + 1);
+		}
+		ok &= covered == dense;
+
+		std::cout << "Isosurface cells over " << cells << "^3 at frequency " << frequency << " found in " << sparse_time
+		          << " seconds with range bounds (dense " << dense_time << " seconds), " << sparse << "/" << dense << " crossings, "
+		          << visited.size() << "/" << (cells / leaf) * (cells / leaf) * (cells / leaf) << " leaf blocks sampled\n";
+	}
+	return ok;
+}
+
+bool test_quadtree_sampler()
+{
+	constexpr uint32_t levels = 10;
+	constexpr size_t cells = size_t(1) << levels;
+	constexpr double extent = 8.0, tolerance = 0.01;
+
+	OpenSimplex2S<2, osn::Mode::Standard_2D> osn2d(2024);
+	bool ok = true;
+
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+	QuadtreeSampler<OpenSimplex2S<2, osn::Mode::Standard_2D>> tree(osn2d, -3.0, 5.0, extent, tolerance, levels);
+	std::vector<uint32_t> triangles = tree.triangles();
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float adaptive_time = std::chrono::duration<float>(end - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	std::vector<float> grid((cells + 1) * (cells + 1));
+	osn2d.generate(grid.data(), { cells + 1, cells + 1 }, { -3.0f, 5.0f }, float(tree.step()));
+	end = std::chrono::high_resolution_clock::now();
+	float uniform_time = std::chrono::duration<float>(end - start).count();
+
+	// Every leaf interpolates the dense grid within the tolerance, and the triangles tile the square exactly.
+	const std::vector<QuadtreeSampler<OpenSimplex2S<2, osn::Mode::Standard_2D>>::Sample>& samples = tree.samples();
+	double max_error = 0, area = 0;
+	for (const auto& leaf : tree.leaves())
+	{
+		for (uint32_t j = 0; j <= leaf.size; ++j)
+			for (uint32_t i = 0; i <= leaf.size; ++i)
+			{
+				double u = double(i) / leaf.size, v = double(j) / leaf.size;
+				double bilinear = (1 - v) * ((1 - u) * samples[leaf.corners[0]].value + u * samples[leaf.corners[1]].value)
+				      + v * ((1 - u) * samples[leaf.corners[3]].value + u * samples[leaf.corners[2]].value);
+				max_error = std::max(max_error, std::abs(bilinear - grid[(leaf.y + j) * (cells + 1) + leaf.x + i]));
+			}
+	}
+	for (size_t t = 0; t < triangles.size(); t += 3)
+	{
+		const auto &a = samples[triangles[t]], &b = samples[triangles[t + 1]], &c = samples[triangles[t + 2]];
+		double cross = (double(b.x) - a.x) * (double(c.y) - a.y) - (double(b.y) - a.y) * (double(c.x) - a.x);
+		ok &= cross > 0;
+		area += cross / 2;
+	}
+	ok &= max_error <= tolerance + 1e-4 && std::abs(area - extent * extent) < 1e-3;
+
+	std::cout << "Quadtree sampling of " << cells << "^2 within " << tolerance << " took " << adaptive_time
+	          << " seconds for " << samples.size() << " samples (uniform " << uniform_time << " seconds for "
+	          << grid.size() << " samples), " << tree.leaves().size() << " leaves, max error " << max_error << "\n";
+	return ok;
+}
+
+// Renders frames of XYBeforeZ-style animated noise at 4K, through generate_slice and point by point. The 3D kernel
+// has tiny jumps where its lattice traversal switches blocks, so a rare pixel may differ past rounding when the two
+// paths round to opposite sides of one.
+template<typename _Noise>
+bool test_slice_frames(const _Noise& noise, size_t frames)
+{
+	constexpr uint32_t D = _Noise::Dimensions;
+	const size_t width = 3840, height = 2160;
+	const float step = 1.0f / 256;
+
+	std::vector<float> frame(width * height);
+	float slice_time = 0, point_time = 0;
+	size_t mismatches = 0;
+	for (size_t f = 0; f < frames; ++f)
+	{
+		std::array<float, D - 2> slice;
+		slice.fill(0.05f * f);
+
+		std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+		noise.generate_slice(frame.data(), width, height, { 0, 0 }, step, slice);
+		std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+		slice_time += std::chrono::duration<float>(end - start).count();
+
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t y = 0; y < height; ++y)
+			for (size_t x = 0; x < width; ++x)
+			{
+				float v = std::apply([&](auto... t) { return noise(x * step, y * step, t...); }, slice);
+				mismatches += std::abs(v - frame[y * width + x]) > 1e-4f;
+			}
+		end = std::chrono::high_resolution_clock::now();
+		point_time += std::chrono::duration<float>(end - start).count();
+	}
+
+	std::cout << D << "D slice frames at " << width << "x" << height << " took " << slice_time * 1e3 / frames
+	          << " ms/frame (per-point " << point_time * 1e3 / frames << " ms/frame), " << mismatches << " pixels differing\n";
+	return mismatches * 10000 < width * height * frames;
+}
+
+// High-priority chunk latency while a producer keeps the low-priority queue full, compared with queueing the same
+// requests at low priority behind the backlog. Also checks results against generate() and that cancelled requests
+// are dropped.
+bool test_async_generator()
+{
+	typedef OpenSimplex2S<2, osn::Mode::Standard_2D> Noise;
+	constexpr size_t n_threads = 4, chunk_size = 128, n_requests = 200;
+	const float step = 0.01f;
+	Noise osn2d(77);
+	bool ok = true;
+
+	AsyncGenerator<Noise> generator(osn2d, n_threads, 64);
+
+	std::vector<float> expected(chunk_size * chunk_size);
+	osn2d.generate(expected.data(), { chunk_size, chunk_size }, { 1.0f, 2.0f }, step);
+	ok &= generator.submit({ chunk_size, chunk_size }, { 1.0f, 2.0f }, step, Priority::High).get() == expected;
+
+	// A group of prefetches abandoned right after submission is mostly dropped.
+	{
+		CancellationToken token;
+		std::vector<std::future<std::vector<float>>> prefetches;
+		for (size_t r = 0; r < 64; ++r)
+			prefetches.push_back(generator.submit({ chunk_size, chunk_size }, { float(r), 0.0f }, step, Priority::Low, token));
+		token.cancel();
+		size_t dropped = 0;
+		for (std::future<std::vector<float>>& f : prefetches)
+		{
+			try
+			{
+				f.get();
+			}
+			catch (const GenerationCancelled&)
+			{
+				++dropped;
+			}
+		}
+		ok &= dropped > 0 && generator.stats().cancelled == dropped;
+	}
+
+	auto latencies = [&](Priority priority) {
+		CancellationToken background;
+		std::atomic<bool> loading{ true };
+		std::thread producer([&]() {
+			for (size_t r = 0; loading; ++r)
+				generator.submit({ chunk_size, chunk_size }, { float(r % 1000), 5.0f }, step, Priority::Low, background);
+		});
+
+		std::vector<double> times;
+		for (size_t r = 0; r < n_requests; ++r)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+			generator.submit({ chunk_size, chunk_size }, { float(r), 9.0f }, step, priority).get();
+			times.push_back(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+
+		loading = false;
+		background.cancel();
+		producer.join();
+		std::sort(times.begin(), times.end());
+		return std::make_pair(times[times.size() / 2], times[times.size() * 99 / 100]);
+	};
+
+	std::pair<double, double> high = latencies(Priority::High);
+	std::pair<double, double> low = latencies(Priority::Low);
+	std::cout << "Async chunks of " << chunk_size << "^2 on " << n_threads << " threads under background load: high priority p50 "
+	          << high.first * 1e3 << " ms, p99 " << high.second * 1e3 << " ms (queued behind the load p50 " << low.first * 1e3
+	          << " ms, p99 " << low.second * 1e3 << " ms), " << generator.stats().completed << " completed, "
+	          << generator.stats().cancelled << " cancelled\n";
+	return ok && high.first < low.first;
+}
+
+// Vector noise: component 0 matches scalar evaluation, the components are uncorrelated with equal spread, and one
+// vector evaluation is timed against the separate, domain-offset scalar calls it replaces.
+template<typename _Noise>
+bool test_vector_noise(const _Noise& noise)
+{
+	constexpr uint32_t D = _Noise::Dimensions;
+	constexpr size_t n = 1 << 20;
+	std::mt19937 rng{ 3 };
+	std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+	std::vector<std::array<float, D>> points(n);
+	for (std::array<float, D>& p : points)
+		for (float& v : p)
+			v = dist(rng);
+
+	bool ok = true;
+	double sum[D] = {}, products[D][D] = {};
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+	for (const std::array<float, D>& p : points)
+	{
+		std::array<float, D> v = std::apply([&](auto... x) { return noise.vector(x...); }, p);
+		for (uint32_t k = 0; k < D; ++k)
+		{
+			sum[k] += v[k];
+			for (uint32_t l = 0; l <= k; ++l)
+				products[k][l] += double(v[k]) * v[l];
+		}
+	}
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float vector_time = std::chrono::duration<float>(end - start).count();
+
+	double scalar_sum = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (const std::array<float, D>& p : points)
+		for (uint32_t k = 0; k < D; ++k)
+			scalar_sum += std::apply([&](auto... x) { return noise((x + 37.1f * k)...); }, p);
+	end = std::chrono::high_resolution_clock::now();
+	float scalar_time = std::chrono::duration<float>(end - start).count();
+
+	for (size_t i = 0; i < 1000; ++i)
+		ok &= std::abs(std::apply([&](auto... x) { return noise.vector(x...)[0] - noise(x...); }, points[i])) < 1e-5f;
+
+	auto covariance = [&](uint32_t k, uint32_t l) { return products[k][l] / n - sum[k] / n * sum[l] / n; };
+	double correlation = 0;
+	for (uint32_t k = 1; k < D; ++k)
+	{
+		ok &= covariance(k, k) > 0.8 * covariance(0, 0) && covariance(k, k) < 1.25 * covariance(0, 0);
+		for (uint32_t l = 0; l < k; ++l)
+			correlation = std::max(correlation, std::abs(covariance(k, l)) / std::sqrt(covariance(k, k) * covariance(l, l)));
+	}
+	ok &= correlation < 0.02;
+
+	std::cout << D << "D vector noise for " << n << " points took " << vector_time << " seconds (" << D
+	          << " scalar calls " << scalar_time << " seconds), largest component correlation " << correlation << " [" << scalar_sum
+	          << "]\n";
+	return ok;
+}
+
+// A warped, masked terrain graph of 15 distinct nodes, compiled and evaluated in tiles, against the same terrain
+// computed one full-size buffer per stage.
+bool test_noise_graph()
+{
+	typedef OpenSimplex2S<2, osn::Mode::Standard_2D> Noise;
+	typedef NoiseGraph<Noise>::Node Node;
+	constexpr size_t side = 1024;
+	const float step = 1.0f;
+	Noise osn2d(77);
+
+	NoiseGraph<Noise> g(osn2d);
+	Node base = g.fbm(0.004f, 5);
+	Node wx = g.multiply(g.multiply(g.noise_at(0.01f, 17.3f), g.constant(15)), g.constant(2));
+	Node wy = g.multiply(g.constant(30), g.noise_at(0.01f, -41.7f));
+	Node warped = g.fbm(0.004f, 5, 2, 0.5f, 0, { wx, wy });
+	Node ridges = g.ridged(0.008f, 4);
+	Node mask = g.clamp(g.remap(g.fbm(0.004f, 5), -0.3f, 0.3f, 0, 1), 0, 1);
+	Node mountains = g.multiply(ridges, g.constant(0.8f));
+	Node plains = g.add(g.multiply(warped, g.constant(0.25f)), g.constant(0.1f));
+	Node land = g.blend(plains, mountains, mask);
+	Node detail = g.multiply(g.noise_at(0.05f, 5.5f), g.add(g.constant(0.01f), g.constant(0.02f)));
+	Node height = g.add(land, detail);
+	Node beach = g.select(height, g.add(g.multiply(height, g.constant(0.5f)), g.constant(0.05f)), base, 0.1f, 0.05f);
+	Node terrain = g.max(g.max(beach, g.constant(-0.2f)), g.constant(-0.1f));
+	NoiseGraph<Noise>::Program program = g.compile(terrain);
+
+	std::vector<float> fused(side * side);
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+	program.generate(fused.data(), { side, side }, { 0, 0 }, step);
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float fused_time = std::chrono::duration<float>(end - start).count();
+
+	// One full-size pass per stage, as hand-written terrain code would do it.
+	const size_t n = side * side;
+	auto x = [&](size_t i) { return float(i % side) * step; };
+	auto y = [&](size_t i) { return float(i / side) * step; };
+	auto smoothstep = [](float t) {
+		t = std::min(std::max(t, 0.0f), 1.0f);
+		return t * t * (3 - 2 * t);
+	};
+	start = std::chrono::high_resolution_clock::now();
+	std::vector<float> s_base(n), s_nx(n), s_ny(n), s_warped(n), s_ridges(n), s_mask(n), s_land(n), s_detail(n), s_out(n);
+	for (size_t i = 0; i < n; ++i)
+		s_base[i] = osn2d.fbm(5, 2.0f, 0.5f, x(i) * 0.004f, y(i) * 0.004f);
+	for (size_t i = 0; i < n; ++i)
+		s_nx[i] = osn2d(x(i) * 0.01f + 17.3f, y(i) * 0.01f + 17.3f);
+	for (size_t i = 0; i < n; ++i)
+		s_nx[i] *= 30;
+	for (size_t i = 0; i < n; ++i)
+		s_ny[i] = osn2d(x(i) * 0.01f - 41.7f, y(i) * 0.01f - 41.7f);
+	for (size_t i = 0; i < n; ++i)
+		s_ny[i] *= 30;
+	for (size_t i = 0; i < n; ++i)
+		s_warped[i] = osn2d.fbm(5, 2.0f, 0.5f, (x(i) + s_nx[i]) * 0.004f, (y(i) + s_ny[i]) * 0.004f);
+	for (size_t i = 0; i < n; ++i)
+	{
+		float value = 0, amplitude = 1, frequency = 0.008f;
+		for (uint32_t o = 0; o < 4; ++o, amplitude *= 0.5f, frequency *= 2)
+		{
+			float r = 1 - std::abs(osn2d(x(i) * frequency, y(i) * frequency));
+			value += amplitude * r * r;
+		}
+		s_ridges[i] = value;
+	}
+	for (size_t i = 0; i < n; ++i)
+		s_mask[i] = std::min(std::max((s_base[i] + 0.3f) / 0.6f, 0.0f), 1.0f);
+	for (size_t i = 0; i < n; ++i)
+		s_land[i] = s_warped[i] * 0.25f + 0.1f + (s_ridges[i] * 0.8f - (s_warped[i] * 0.25f + 0.1f)) * s_mask[i];
+	for (size_t i = 0; i < n; ++i)
+		s_detail[i] = osn2d(x(i) * 0.05f + 5.5f, y(i) * 0.05f + 5.5f) * 0.03f;
+	for (size_t i = 0; i < n; ++i)
+		s_land[i] += s_detail[i];
+	for (size_t i = 0; i < n; ++i)
+	{
+		float t = smoothstep((s_base[i] - 0.1f + 0.05f) / 0.1f);
+		s_out[i] = s_land[i] + (s_land[i] * 0.5f + 0.05f - s_land[i]) * t;
+	}
+	for (size_t i = 0; i < n; ++i)
+		s_out[i] = std::max(s_out[i], -0.1f);
+	end = std::chrono::high_resolution_clock::now();
+	float staged_time = std::chrono::duration<float>(end - start).count();
+
+	float max_error = 0;
+	for (size_t i = 0; i < n; ++i)
+		max_error = std::max(max_error, std::abs(fused[i] - s_out[i]));
+
+	std::cout << "Noise graph compiled to " << program.instruction_count() << " nodes in " << program.slot_count()
+	          << " tile buffers, " << side << "^2 took " << fused_time << " seconds (per-stage passes " << staged_time
+	          << " seconds in 9 full-size buffers), max error " << max_error << "\n";
+	return max_error < 1e-4f;
+}
+
+// Fused quantized grids against generating floats and converting them in a second pass, for every output format.
+template<typename _Out>
+bool test_quantized_format(const char* name, float scale, float bias)
+{
+	constexpr size_t side = 2048;
+	OpenSimplex2S<2, osn::Mode::Standard_2D> osn2d(77);
+
+	std::vector<_Out> fused(side * side), converted(side * side);
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+	osn2d.generate_quantized(fused.data(), { side, side }, { 0, 0 }, 0.01f, scale, bias);
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float fused_time = std::chrono::duration<float>(end - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	std::vector<float> values(side * side);
+	osn2d.generate(values.data(), { side, side }, { 0, 0 }, 0.01f);
+	for (size_t i = 0; i < values.size(); ++i)
+		converted[i] = osn::_detail::quantizer<_Out>::store(values[i] * scale + bias);
+	end = std::chrono::high_resolution_clock::now();
+	float two_pass_time = std::chrono::duration<float>(end - start).count();
+
+	bool same = std::memcmp(fused.data(), converted.data(), fused.size() * sizeof(_Out)) == 0;
+	std::cout << "Quantized " << name << " grid of " << side << "^2 took " << fused_time << " seconds in "
+	          << fused.size() * sizeof(_Out) << " bytes (float then convert " << two_pass_time << " seconds in "
+	          << values.size() * (sizeof(float) + sizeof(_Out)) << " bytes)\n";
+	return same;
+}
+
+bool test_quantized_output()
+{
+	bool ok = true;
+
+	// Conversions round to nearest even and saturate to infinity.
+	ok &= Half(1.0f).bits == 0x3C00 && Half(-2.0f).bits == 0xC000 && Half(65504.0f).bits == 0x7BFF;
+	ok &= Half(65520.0f).bits == 0x7C00 && Half(1.0f + 1.0f / 2048).bits == 0x3C00 && Half(1.0f + 3.0f / 2048).bits == 0x3C02;
+	ok &= Half(5.960464477539063e-08f).bits == 0x0001 && float(Half(0.333333f)) == 0.333251953125f;
+	ok &= BFloat16(1.0f).bits == 0x3F80 && BFloat16(1.0f + 1.0f / 256).bits == 0x3F80 && float(BFloat16(-3.0f)) == -3.0f;
+	for (float v = -1; v <= 1; v += 0.001f)
+		ok &= std::abs(float(Half(v)) - v) <= std::abs(v) / 2048 + 3e-8f && std::abs(float(BFloat16(v)) - v) <= std::abs(v) / 256;
+
+	// NaN, as from a NaN scale, stores as 0 in the integer formats, and infinities saturate.
+	OpenSimplex2S<2, osn::Mode::Standard_2D> osn2d(7);
+	uint8_t u8[4];
+	uint16_t u16[4];
+	const float nan = std::numeric_limits<float>::quiet_NaN(), inf = std::numeric_limits<float>::infinity();
+	osn2d.generate_quantized(u8, { 2, 2 }, { 0.3f, 0.7f }, 0.1f, nan, 0.0f);
+	osn2d.generate_quantized(u16, { 2, 2 }, { 0.3f, 0.7f }, 0.1f, 0.0f, inf);
+	for (size_t i = 0; i < 4; ++i)
+		ok &= u8[i] == 0 && u16[i] == 65535;
+
+	ok &= test_quantized_format<uint8_t>("uint8", 127.5f, 127.5f);
+	ok &= test_quantized_format<uint16_t>("uint16", 32767.5f, 32767.5f);
+	ok &= test_quantized_format<Half>("fp16", 1, 0);
+	ok &= test_quantized_format<BFloat16>("bf16", 1, 0);
+	return ok;
+}
+
+// Sum of noise samples in 2D, 3D and 4D, which changes with any change to the seed's permutation.
+template<typename _SeedT>
+double seed_checksum(_SeedT seed)
+{
+	OpenSimplex2S<2, osn::Mode::Standard_2D, double> osn2d(seed);
+	OpenSimplex2S<3, osn::Mode::Classic_3D, double> osn3d(seed);
+	OpenSimplex2S<4, osn::Mode::Classic_4D, double> osn4d(seed);
+	double sum = 0;
+	for (int i = 0; i < 64; ++i)
+		sum += (i + 1)
+		       * (osn2d(i * 0.37, i * -0.61) + osn3d(i * 0.29, -i * 0.43, i * 0.71)
+		          + osn4d(i * 0.31, i * 0.17, -i * 0.53, i * 0.23));
+	return sum;
+}
+
+// The shuffle as it was before seed_shuffle: a 64-bit modulo per step, made non-negative for signed seeds.
+template<typename _SeedT>
+void modulo_shuffle(
+      std::array<uint16_t, osn::_detail::PSIZE>& perm,
+      std::array<osn::_detail::grad<4, float>, osn::_detail::PSIZE>& permGrad,
+      _SeedT seed)
+{
+	std::array<uint16_t, osn::_detail::PSIZE> source;
+	for (int32_t i = 0; i < osn::_detail::PSIZE; i++)
+		source[i] = uint16_t(i);
+	for (int32_t i = osn::_detail::PSIZE - 1; i >= 0; i -= 1)
+	{
+		seed = seed * 6364136223846793005L + 1442695040888963407L;
+		_SeedT r = (_SeedT)((seed + 31) % (i + 1));
+		if (std::is_signed<_SeedT>::value && r < 0)
+			r += i + 1;
+		perm[i] = source[r];
+		permGrad[i] = osn::_detail::pregen_gradients<4, float>::grads[perm[i]];
+		source[r] = source[i];
+	}
+}
+
+// Permutations must stay those of the original per-step 64-bit modulo, for every signedness and width of seed.
+bool test_reseed()
+{
+	bool ok = true;
+	ok &= std::abs(seed_checksum(uint64_t(0)) - 73.246063183368278) < 1e-9;
+	ok &= std::abs(seed_checksum(uint64_t(0xDEADBEEFCAFEBABEull)) - -39.150116010850411) < 1e-9;
+	ok &= std::abs(seed_checksum(int64_t(-123456789)) - 208.31230327322152) < 1e-9;
+	ok &= std::abs(seed_checksum(int64_t(42)) - 3.6251970230444268) < 1e-9;
+	ok &= std::abs(seed_checksum(int32_t(-7)) - -270.11903008677416) < 1e-9;
+	ok &= std::abs(seed_checksum(uint32_t(3000000000u)) - 60.17266987178968) < 1e-9;
+	ok &= std::abs(seed_checksum(1234) - 101.30453984807522) < 1e-9;
+
+	const size_t count = 2048;
+	std::vector<int64_t> seeds(count);
+	for (size_t k = 0; k < count; ++k)
+		seeds[k] = int64_t(k * 0x9E3779B97F4A7C15ull);
+
+	// The shuffle alone, reciprocal remainders against the modulo loop, on the same tables for the same seeds.
+	std::vector<std::array<uint16_t, osn::_detail::PSIZE>> perms(count), modulo(count);
+	std::array<osn::_detail::grad<4, float>, osn::_detail::PSIZE> grads;
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+	for (size_t k = 0; k < count; ++k)
+		osn::_detail::seed_shuffle<int64_t>::shuffle(perms[k], grads, seeds[k]);
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float shuffle_time = std::chrono::duration<float>(end - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t k = 0; k < count; ++k)
+		modulo_shuffle(modulo[k], grads, seeds[k]);
+	end = std::chrono::high_resolution_clock::now();
+	float modulo_time = std::chrono::duration<float>(end - start).count();
+	ok &= perms == modulo;
+
+	std::array<uint16_t, osn::_detail::PSIZE> a, b;
+	for (uint64_t seed : { uint64_t(0), uint64_t(1) << 63, ~uint64_t(0) })
+	{
+		osn::_detail::seed_shuffle<uint64_t>::shuffle(a, grads, seed);
+		modulo_shuffle(b, grads, seed);
+		ok &= a == b;
+	}
+
+	// Storage is allocated up front and untimed, so reseeding in place and constructing over the same elements do
+	// the same work on the same memory.
+	typedef OpenSimplex2S<4, osn::Mode::Classic_4D> Noise;
+	std::vector<Noise> noises(count), constructed(count);
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t k = 0; k < count; ++k)
+		noises[k].reseed(seeds[k]);
+	end = std::chrono::high_resolution_clock::now();
+	float reseed_time = std::chrono::duration<float>(end - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t k = 0; k < count; ++k)
+		new (&constructed[k]) Noise(seeds[k]);
+	end = std::chrono::high_resolution_clock::now();
+	float construct_time = std::chrono::duration<float>(end - start).count();
+
+	for (size_t k = 0; k < count; k += 97)
+	{
+		Noise fresh(seeds[k]);
+		ok &= noises[k](0.3f, 0.1f, -0.7f, 2.5f) == fresh(0.3f, 0.1f, -0.7f, 2.5f) && noises[k].seed() == fresh.seed();
+	}
+	ok &= constructed[count - 1](0.3f, 0.1f, -0.7f, 2.5f) == noises[count - 1](0.3f, 0.1f, -0.7f, 2.5f);
+
+	std::cout << "Seed shuffles: reciprocal " << count / shuffle_time << "/s, per-step modulo " << count / modulo_time
+	          << "/s; 4D seeds: reseed " << count / reseed_time << " seeds/s, construct per seed "
+	          << count / construct_time << " seeds/s\n";
+	return ok;
+}
+
+bool test_fractal_pyramid()
+{
+	const size_t side = 1025;
+	const uint32_t levels = 6, octaves = 8;
+	OpenSimplex2S<2, osn::Mode::Standard_2D> osn2d(77);
+	FractalPyramid<OpenSimplex2S<2, osn::Mode::Standard_2D>> pyramid(osn2d, side, levels, octaves, -3.5, 12.25, 1.0 / 256);
+
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+	std::vector<std::vector<float>> shared = pyramid.generate();
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float shared_time = std::chrono::duration<float>(end - start).count();
+
+	std::vector<std::vector<float>> independent(levels);
+	start = std::chrono::high_resolution_clock::now();
+	for (uint32_t l = 0; l < levels; ++l)
+		independent[l] = pyramid.generate_level(l);
+	end = std::chrono::high_resolution_clock::now();
+	float independent_time = std::chrono::duration<float>(end - start).count();
+
+	bool ok = true;
+	size_t evaluations = 0;
+	for (uint32_t l = 0; l < levels; ++l)
+	{
+		ok &= shared[l] == independent[l];
+		evaluations += pyramid.level_side(l) * pyramid.level_side(l) * pyramid.octaves(l);
+	}
+	std::cout << "Fractal pyramid of " << levels << " levels from " << side << "^2 with " << octaves << " octaves took "
+	          << shared_time << " seconds for " << side * side * octaves << " evaluations (levels one at a time "
+	          << independent_time << " seconds for " << evaluations << ")\n";
+	return ok;
+}
+
+// Points a few float epsilons from a lattice point can have a rotated coordinate just below a whole number, whose
+// offset into the cell then rounds up to a whole 1. The pruned 3D kernel must still read the cell's last quarter
+// rather than past the end of its tables, and agree with double precision there.
+template<osn::Mode _Mode>
+bool test_pruned_cell_edges()
+{
+	OpenSimplex2S<3, _Mode, float, int32_t, std::ratio<1, 2>> noise(77);
+	OpenSimplex2S<3, _Mode, double, int32_t, std::ratio<1, 2>> reference(77);
+
+	double error = 0;
+	for (double epsilon : { -3e-8, -1e-8, -3e-9, -1e-9, 1e-9, 3e-9, 1e-8 })
+		for (uint32_t axes = 1; axes < 8; ++axes)
+		{
+			std::array<float, 3> p;
+			for (uint32_t k = 0; k < 3; ++k)
+				p[k] = (axes >> k) & 1 ? float(epsilon) : 0.0f;
+			error = std::max(error, std::abs(noise(p[0], p[1], p[2]) - reference(double(p[0]), double(p[1]), double(p[2]))));
+		}
+	return error < 1e-6;
+}
+
+// Grid generation time at squared kernel radius _RadiusSq against the default. The smaller kernel's output must stay
+// within [-1, 1] and be continuous: a lattice point pruned from a row it can reach shows up as a jump.
+template<uint32_t _D, osn::Mode _Mode, typename _RadiusSq>
+bool test_kernel_radius(size_t side)
+{
+	OpenSimplex2S<_D, _Mode, double> full(77);
+	OpenSimplex2S<_D, _Mode, double, int32_t, _RadiusSq> pruned(77);
+
+	std::array<size_t, _D> size;
+	std::array<double, _D> origin;
+	size.fill(side);
+	origin.fill(-7.25);
+	std::vector<double> values(size_t(std::pow(double(side), double(_D))));
+
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+	full.generate(values.data(), size, origin, 0.061);
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float full_time = std::chrono::duration<float>(end - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	pruned.generate(values.data(), size, origin, 0.061);
+	end = std::chrono::high_resolution_clock::now();
+	float pruned_time = std::chrono::duration<float>(end - start).count();
+
+	bool ok = true;
+	double peak = 0;
+	for (double v : values)
+	{
+		peak = std::max(peak, std::abs(v));
+	}
+	ok &= peak <= 1;
+
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<double> coordinate(-40, 40);
+	double jump = 0;
+	for (size_t n = 0; n < 100000; ++n)
+	{
+		std::array<double, _D> p, q;
+		for (uint32_t k = 0; k < _D; ++k)
+		{
+			p[k] = coordinate(rng);
+			q[k] = p[k] + 1e-6;
+		}
+		double a = std::apply([&](auto... v) { return pruned(v...); }, p);
+		double b = std::apply([&](auto... v) { return pruned(v...); }, q);
+		jump = std::max(jump, std::abs(a - b));
+	}
+	ok &= jump < 1e-3;
+
+	std::cout << _D << "D kernel radius^2 " << _RadiusSq::num << "/" << _RadiusSq::den << ": " << side << "^" << _D
+	          << " grid took " << pruned_time << " seconds (default radius " << full_time << "), peak " << peak
+	          << ", largest step " << jump << "\n";
+	return ok;
+}
+
+// Hardware counter breakdown of the kernels per dimension, orientation and access pattern. Where the counters are
+// unavailable, as in most containers, the profile must still carry the wall-clock times.
+bool test_perf_profile()
+{
+	const size_t count = 1 << 18;
+	std::vector<KernelProfile> profiles;
+	for (ProfilePattern pattern : { ProfilePattern::Grid, ProfilePattern::Scattered })
+	{
+		std::string name = pattern == ProfilePattern::Grid ? " grid" : " scattered";
+		profiles.push_back(profile_kernel(OpenSimplex2S<2, osn::Mode::Standard_2D>(77), pattern, count, "2D Standard" + name));
+		profiles.push_back(profile_kernel(OpenSimplex2S<2, osn::Mode::XBeforeY_2D>(77), pattern, count, "2D XBeforeY" + name));
+		profiles.push_back(profile_kernel(OpenSimplex2S<3, osn::Mode::Classic_3D>(77), pattern, count, "3D Classic" + name));
+		profiles.push_back(profile_kernel(OpenSimplex2S<3, osn::Mode::XZBeforeY_3D>(77), pattern, count, "3D XZBeforeY" + name));
+		profiles.push_back(profile_kernel(OpenSimplex2S<4, osn::Mode::Classic_4D>(77), pattern, count, "4D Classic" + name));
+		profiles.push_back(profile_kernel(OpenSimplex2S<4, osn::Mode::XYZBeforeW_4D>(77), pattern, count, "4D XYZBeforeW" + name));
+	}
+
+	bool ok = true;
+	for (const KernelProfile& profile : profiles)
+	{
+		profile.report(std::cout);
+		ok &= profile.points == count && profile.full.seconds > 0 && profile.full.seconds >= profile.stream.seconds;
+		ok &= profile.full.hardware == PerfCounters().available();
+		if (profile.full.hardware)
+		{
+			ok &= profile.full[PerfEvent::Instructions] > profile.stream[PerfEvent::Instructions];
+		}
+	}
+	return ok;
+}
+
+// A grid and a batch of scattered points through AnyOpenSimplex2S and through the templated noise, which must agree
+// exactly and take about as long.
+template<uint32_t _D, osn::Mode _Mode>
+bool test_any_mode(size_t side)
+{
+	OpenSimplex2S<_D, _Mode> typed(77);
+	AnyOpenSimplex2S<> any(_Mode, 77);
+	std::array<size_t, _D> size;
+	std::array<float, _D> origin;
+	size_t total = 1;
+	for (uint32_t k = 0; k < _D; ++k)
+	{
+		size[k] = side;
+		origin[k] = -3.5f + 1.25f * float(k);
+		total *= side;
+	}
+
+	std::vector<float> typed_grid(total), any_grid(total);
+	std::chrono::time_point<std::chrono::high_resolution_clock> start = std::chrono::high_resolution_clock::now();
+	typed.generate(typed_grid.data(), size, origin, 0.03f);
+	std::chrono::time_point<std::chrono::high_resolution_clock> end = std::chrono::high_resolution_clock::now();
+	float typed_grid_time = std::chrono::duration<float>(end - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	std::apply(
+	      [&](auto... s) {
+		      std::apply([&](auto... o) { any.generate(any_grid.data(), { s... }, { o... }, 0.03f); }, origin);
+	      },
+	      size);
+	end = std::chrono::high_resolution_clock::now();
+	float any_grid_time = std::chrono::duration<float>(end - start).count();
+
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> coord(-50, 50);
+	std::vector<float> points(total * _D);
+	for (float& v : points)
+		v = coord(rng);
+
+	std::vector<float> typed_batch(total), any_batch(total), any_single(total);
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t n = 0; n < total; ++n)
+	{
+		std::array<float, _D> p;
+		std::copy(points.begin() + n * _D, points.begin() + (n + 1) * _D, p.begin());
+		typed_batch[n] = std::apply([&](auto... v) { return typed(v...); }, p);
+	}
+	end = std::chrono::high_resolution_clock::now();
+	float typed_batch_time = std::chrono::duration<float>(end - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	any.evaluate(points.data(), total, any_batch.data());
+	end = std::chrono::high_resolution_clock::now();
+	float any_batch_time = std::chrono::duration<float>(end - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t n = 0; n < total; ++n)
+	{
+		std::array<float, _D> p;
+		std::copy(points.begin() + n * _D, points.begin() + (n + 1) * _D, p.begin());
+		any_single[n] = std::apply([&](auto... v) { return any(v...); }, p);
+	}
+	end = std::chrono::high_resolution_clock::now();
+	float any_single_time = std::chrono::duration<float>(end - start).count();
+
+	std::cout << _D << "D mode " << int(_Mode) << " chosen at run time: " << total << " grid points took "
+	          << any_grid_time << " seconds (templated " << typed_grid_time << "), as many scattered points "
+	          << any_batch_time << " seconds batched, " << any_single_time << " one at a time (templated "
+	          << typed_batch_time << ")\n";
+	return typed_grid == any_grid && typed_batch == any_batch && typed_batch == any_single;
+}
+
+// Modes of one dimension share a seed's tables; another dimension builds its own from the same seed.
+bool test_any_tables()
+{
+	AnyOpenSimplex2S<> classic(osn::Mode::Classic_3D, 77);
+	AnyOpenSimplex2S<> xz = classic.with_mode(osn::Mode::XZBeforeY_3D);
+	AnyOpenSimplex2S<> standard = classic.with_mode(osn::Mode::Standard_2D);
+	AnyOpenSimplex2S<> copy = classic;
+	bool ok = xz.shares_tables(classic) && copy.shares_tables(classic) && !standard.shares_tables(classic);
+	ok &= xz.mode() == osn::Mode::XZBeforeY_3D && xz.dimensions() == 3 && standard.dimensions() == 2;
+	ok &= xz(1.5f, -2.25f, 0.5f) == OpenSimplex2S<3, osn::Mode::XZBeforeY_3D>(77)(1.5f, -2.25f, 0.5f);
+	ok &= standard(1.5f, -2.25f) == OpenSimplex2S<2, osn::Mode::Standard_2D>(77)(1.5f, -2.25f);
+
+	bool threw = false;
+	try
+	{
+		standard(1.0f, 2.0f, 3.0f);
+	}
+	catch (const std::invalid_argument&)
+	{
+		threw = true;
+	}
+	return ok && threw;
+}
+
+#ifndef _WIN32
+// Processes walking the same region of chunks, each through its own mapping of one shared chunk cache, against the
+// same processes generating every chunk themselves, by the children's total CPU time. Then a process that dies
+// holding one chunk and generating another must leave neither unusable.
+bool test_shared_chunk_cache()
+{
+	typedef OpenSimplex2S<2, osn::Mode::Standard_2D> noise_t;
+	const size_t chunk_size = 64, n_processes = 4, n_requests = 2000, n_slots = 1024;
+	const double frequency = 0.01;
+	const std::string name = "/osn_test_" + std::to_string(getpid());
+	SharedChunkCache<float>::remove(name);
+	SharedChunkCache<float> cache(name, n_slots, chunk_size * chunk_size);
+
+	auto children_time = []() {
+		rusage usage;
+		getrusage(RUSAGE_CHILDREN, &usage);
+		return double(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+		       + 1e-6 * double(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+	};
+
+	// Every 64th cached chunk is checked against one generated on the spot.
+	auto run = [&](bool cached) {
+		std::vector<pid_t> children;
+		for (size_t p = 0; p < n_processes; ++p)
+		{
+			pid_t pid = fork();
+			if (pid != 0)
+			{
+				children.push_back(pid);
+				continue;
+			}
+			bool same = true;
+			{
+				noise_t noise(77);
+				std::unique_ptr<SharedChunkCache<float>> shared;
+				if (cached)
+					shared.reset(new SharedChunkCache<float>(name, n_slots, chunk_size * chunk_size));
+				std::mt19937 rng{ uint32_t(p) };
+				std::array<int64_t, 2> chunk{ int64_t(rng() % 24), int64_t(rng() % 24) };
+				std::vector<float> values(chunk_size * chunk_size);
+				for (size_t r = 0; r < n_requests; ++r)
+				{
+					if (rng() % 10 == 0)
+						chunk = { int64_t(rng() % 24), int64_t(rng() % 24) };
+					else
+					{
+						size_t axis = rng() % 2;
+						chunk[axis] = (chunk[axis] + 23 + int64_t(rng() % 3)) % 24;
+					}
+
+					if (!cached || r % 64 == 0)
+						noise.generate(values.data(),
+						               { chunk_size, chunk_size },
+						               { float(chunk[0] * chunk_size * frequency), float(chunk[1] * chunk_size * frequency) },
+						               float(frequency));
+					if (cached)
+					{
+						SharedChunkCache<float>::ChunkView view = shared->get(noise, chunk, chunk_size, frequency);
+						if (r % 64 == 0)
+							same &= std::equal(view.begin(), view.end(), values.begin());
+					}
+				}
+			}
+			_exit(same ? 0 : 1);
+		}
+
+		bool ok = true;
+		for (pid_t pid : children)
+		{
+			int status = 0;
+			ok &= waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		}
+		return ok;
+	};
+
+	double start = children_time();
+	bool ok = run(false);
+	double uncached_time = children_time() - start;
+	start = children_time();
+	ok &= run(true);
+	double cached_time = children_time() - start;
+
+	SharedChunkCacheStats stats = cache.stats();
+	std::cout << "Shared chunk cache, " << n_processes << " processes x " << n_requests << " requests took "
+	          << cached_time << " CPU seconds in total (uncached " << uncached_time << "), hit rate "
+	          << stats.hit_rate() << ", " << stats.saved_seconds << " CPU seconds saved by hits, " << stats.evictions
+	          << " evictions\n";
+	ok &= stats.hits + stats.misses == n_processes * n_requests && cache.pinned() == 0;
+
+	ChunkKey held, dying;
+	held.seed = 1;
+	dying.seed = 2;
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		SharedChunkCache<float> child(name, n_slots, chunk_size * chunk_size);
+		SharedChunkCache<float>::ChunkView view = child.get(held, 16, [](float* v) { std::fill(v, v + 16, 1.0f); });
+		child.get(dying, 16, [](float*) { _exit(0); });
+	}
+	int status = 0;
+	ok &= waitpid(pid, &status, 0) == pid;
+	ok &= cache.pinned() == 1 && cache.recover() == 1 && cache.pinned() == 0 && cache.stats().recovered == 1;
+
+	bool regenerated = false;
+	ok &= cache.get(dying, 16, [&](float* v) {
+		            regenerated = true;
+		            std::fill(v, v + 16, 2.0f);
+	            })[0] == 2.0f;
+	ok &= regenerated && cache.get(held, 16, [&](float*) { ok = false; })[0] == 1.0f;
+
+	SharedChunkCache<float>::remove(name);
+	return ok;
+}
+
+// A tile service on its own thread, checked against fractal sums of the templated noise and then loaded by clients
+// fetching overlapping boxes of tiles, more of them than the shared cache holds.
+bool test_tile_service()
 {
+	const std::string socket_path = "/tmp/osn_test_" + std::to_string(getpid()) + ".sock";
+	const std::string cache_name = "/osn_tiles_" + std::to_string(getpid());
+	const size_t n_slots = 2048, slot_values = 32 * 32 * 32;
+	SharedChunkCache<float>::remove(cache_name);
+	TileServer<float> server(socket_path, cache_name, n_slots, slot_values, 2);
+	std::thread serving([&]() { server.run(); });
+	SharedChunkCache<float> cache(cache_name, n_slots, slot_values);
+
+	bool ok = true;
+	{
+		TileClient<float> client(socket_path, cache);
+		TileRequest request;
+		request.seed = 77;
+		request.mode = osn::Mode::XBeforeY_2D;
+		request.tileSize = 32;
+		request.frequency = 0.01;
+		request.octaves = 4;
+		request.first = { -1, 2, 0, 0 };
+		request.last = { 0, 3, 0, 0 };
+		std::vector<TileClient<float>::ChunkView> views = client.fetch(request);
+
+		OpenSimplex2S<2, osn::Mode::XBeforeY_2D> noise(uint64_t(77));
+		std::vector<float> expected(32 * 32), layer(32 * 32);
+		std::vector<std::array<int64_t, 4>> tiles = request.tiles();
+		ok &= views.size() == 4 && client.round_trips() == 1;
+		for (size_t t = 0; t < tiles.size() && ok; ++t)
+		{
+			float amplitude = 1;
+			for (uint32_t o = 0; o < request.octaves; ++o)
+			{
+				double f = std::pow(request.lacunarity, double(o));
+				noise.generate(o == 0 ? expected.data() : layer.data(),
+				               { 32, 32 },
+				               { float(double(tiles[t][0]) * 32 * request.frequency * f), float(double(tiles[t][1]) * 32 * request.frequency * f) },
+				               float(request.frequency * f));
+				if (o > 0)
+					for (size_t n = 0; n < layer.size(); ++n)
+						expected[n] += amplitude * layer[n];
+				amplitude *= float(request.gain);
+			}
+			ok &= views[t].shared() && std::equal(views[t].begin(), views[t].end(), expected.begin());
+		}
+
+		// Cached tiles are read without asking the server.
+		ok &= client.fetch(request).size() == 4 && client.round_trips() == 1;
+
+		request.mode = osn::Mode::Classic_3D;
+		request.first = { 0, 0, 5, 0 };
+		request.last = { 0, 0, 5, 0 };
+		request.octaves = 1;
+		std::vector<float> volume(32 * 32 * 32);
+		OpenSimplex2S<3, osn::Mode::Classic_3D>(uint64_t(77)).generate(volume.data(), { 32, 32, 32 }, { 0.0f, 0.0f, float(5 * 32 * 0.01) }, 0.01f);
+		views = client.fetch(request);
+		ok &= std::equal(views[0].begin(), views[0].end(), volume.begin());
+
+		// The seed's type selects the noise as its value does.
+		TileRequest narrow = request;
+		narrow.set_seed(int32_t(-7));
+		OpenSimplex2S<3, osn::Mode::Classic_3D>(int32_t(-7)).generate(volume.data(), { 32, 32, 32 }, { 0.0f, 0.0f, float(5 * 32 * 0.01) }, 0.01f);
+		views = client.fetch(narrow);
+		ok &= narrow.seedType != request.seedType && std::equal(views[0].begin(), views[0].end(), volume.begin());
+		narrow.set_seed(int64_t(-7));
+		views = client.fetch(narrow);
+		ok &= !std::equal(views[0].begin(), views[0].end(), volume.begin());
+
+		auto rejects = [&](const TileRequest& bad) {
+			try
+			{
+				client.fetch(bad);
+			}
+			catch (const std::invalid_argument&)
+			{
+				return true;
+			}
+			return false;
+		};
+		TileRequest bad = request;
+		bad.tileSize = 64;
+		ok &= rejects(bad);
+		bad = request;
+		bad.first = { 0, 0, INT64_MAX, 0 };
+		bad.last = bad.first;
+		ok &= bad.tiles().size() == 1 && bad.tiles()[0] == bad.first && rejects(bad);
+		bad.first = { 0, 0, INT64_MIN, 0 };
+		bad.last = { 0, 0, INT64_MAX, 0 };
+		ok &= bad.tile_count() == TileRequest::MaxTiles + 1 && rejects(bad);
+		bad = request;
+		bad.frequency = std::numeric_limits<double>::quiet_NaN();
+		ok &= rejects(bad);
+		bad = request;
+		bad.gain = std::numeric_limits<double>::infinity();
+		ok &= rejects(bad);
+		bad = request;
+		bad.seedType = 7;
+		ok &= rejects(bad);
+		bad.set_seed(int8_t(-1));
+		bad.seed = 0xFF;
+		ok &= rejects(bad);
+		ok &= client.fetch(request).size() == 1;
+	}
+
+	// A client that sends requests but never reads the replies, a megabyte of them, must not hold up the others.
+	{
+		int stalled = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un address = osn::_detail::unix_address(socket_path);
+		ok &= connect(stalled, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+		TileRequest wide;
+		wide.tileSize = 8;
+		wide.frequency = 0.01;
+		wide.last = { 15, 15, 0, 0 };
+		osn::_detail::tile_request_message message{ osn::_detail::TileProtocolMagic, osn::_detail::TileProtocolVersion, 0, wide };
+		for (int n = 0; n < 256 && send(stalled, &message, sizeof(message), MSG_DONTWAIT | MSG_NOSIGNAL) > 0; ++n)
+			++message.id;
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+		TileClient<float> client(socket_path, cache);
+		TileRequest request;
+		request.tileSize = 16;
+		request.frequency = 0.01;
+		request.first = request.last = { 40, 40, 0, 0 };
+		ok &= client.fetch(request).size() == 1;
+		::close(stalled);
+	}
+
+	TileLoadReport report = run_tile_load(socket_path, cache, 8, 500, [](std::mt19937_64& rng) {
+		TileRequest request;
+		request.seed = 1 + rng() % 2;
+		request.tileSize = 32;
+		request.frequency = 0.02;
+		request.octaves = 3;
+		request.first = { int64_t(rng() % 48), int64_t(rng() % 48), 0, 0 };
+		request.last = { request.first[0] + 1, request.first[1] + 1, 0, 0 };
+		return request;
+	});
+	server.stop();
+	serving.join();
+
+	TileServerStats stats = server.stats();
+	report.report(std::cout);
+	std::cout << "  server: " << stats.requests << " requests in " << stats.batches << " batches, " << stats.tiles
+	          << " tiles of which " << stats.coalesced << " coalesced and " << stats.generated << " generated\n";
+	ok &= report.requests == 8 * 500 && report.tiles == 4 * report.requests && report.percentile(99) >= report.percentile(50);
+	ok &= stats.requests >= report.roundTrips && stats.generated <= stats.tiles;
+	SharedChunkCache<float>::remove(cache_name);
+	return ok;
+}
+#endif
+
+int main()
+{
+	bool ok = true;
+
+	ok &= test_fixed_2d();
+	ok &= test_chunk_cache();
+	ok &= test_async_generator();
+	ok &= test_scanline_stream();
+	ok &= test_tiled_volume();
+	ok &= test_lattice_continuity(OpenSimplex2S<3, osn::Mode::Classic_3D>(77));
+	ok &= test_lattice_continuity(OpenSimplex2S<3, osn::Mode::XYBeforeZ_3D>(77));
+	ok &= test_lattice_continuity(OpenSimplex2S<3, osn::Mode::XZBeforeY_3D>(77));
+	ok &= test_range_bounds();
+	ok &= test_quadtree_sampler();
+	ok &= test_slice_frames(OpenSimplex2S<3, osn::Mode::XYBeforeZ_3D>(77), 2);
+	ok &= test_slice_frames(OpenSimplex2S<4, osn::Mode::XYBeforeZW_4D>(77), 2);
+	ok &= test_vector_noise(OpenSimplex2S<2, osn::Mode::Standard_2D>(77));
+	ok &= test_vector_noise(OpenSimplex2S<3, osn::Mode::XZBeforeY_3D>(77));
+	ok &= test_noise_graph();
+	ok &= test_quantized_output();
+	ok &= test_reseed();
+	ok &= test_fractal_pyramid();
+	ok &= test_pruned_cell_edges<osn::Mode::Classic_3D>();
+	ok &= test_pruned_cell_edges<osn::Mode::XYBeforeZ_3D>();
+	ok &= test_pruned_cell_edges<osn::Mode::XZBeforeY_3D>();
+	ok &= test_kernel_radius<2, osn::Mode::Standard_2D, std::ratio<1, 2>>(1024);
+	ok &= test_kernel_radius<2, osn::Mode::Standard_2D, std::ratio<1, 4>>(1024);
+	ok &= test_kernel_radius<3, osn::Mode::Classic_3D, std::ratio<1, 2>>(96);
+	ok &= test_kernel_radius<3, osn::Mode::Classic_3D, std::ratio<1, 4>>(96);
+	ok &= test_kernel_radius<4, osn::Mode::Classic_4D, std::ratio<3, 5>>(32);
+	ok &= test_kernel_radius<4, osn::Mode::Classic_4D, std::ratio<2, 5>>(32);
+	ok &= test_perf_profile();
+	ok &= test_any_mode<2, osn::Mode::Standard_2D>(1024);
+	ok &= test_any_mode<2, osn::Mode::XBeforeY_2D>(1024);
+	ok &= test_any_mode<3, osn::Mode::Classic_3D>(96);
+	ok &= test_any_mode<3, osn::Mode::XYBeforeZ_3D>(96);
+	ok &= test_any_mode<3, osn::Mode::XZBeforeY_3D>(96);
+	ok &= test_any_mode<4, osn::Mode::Classic_4D>(28);
+	ok &= test_any_mode<4, osn::Mode::XYBeforeZW_4D>(28);
+	ok &= test_any_mode<4, osn::Mode::XZBeforeYW_4D>(28);
+	ok &= test_any_mode<4, osn::Mode::XYZBeforeW_4D>(28);
+	ok &= test_any_tables();
+#ifndef _WIN32
+	ok &= test_shared_chunk_cache();
+	ok &= test_tile_service();
+#endif
+#ifdef OSN_ENABLE_COUNTERS
+	ok &= test_counters();
+#endif
+
+
 	OpenSimplex2S<2, osn::Mode::Standard_2D> osn2d;
 
 	float ph2 = 1.32471795724474602596;
@@ -88,5 +1653,6 @@ void main()
 	end = std::chrono::high_resolution_clock::now();
 
 	std::cout << "3D OSN for " << N_VALUES << " values took " << std::chrono::duration<float>(end - start).count()/ITERATIONS << " seconds\n";
-}
 
+	return ok ? 0 : 1;
+}